@@ -0,0 +1,382 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Engine microbenchmarks. The engine is included rather than linked, so
+ * that its static helpers (allowed(), droplines()) can be measured too.
+ * Every board is generated from a fixed seed, so that runs on the same
+ * machine can be compared with each other.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>		/* __rdtsc() */
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+#include "engine.c"
+
+/*
+ * Macros
+ */
+
+/* Number of operations in a timed batch (each on its own board) */
+#define BATCH 1024
+
+/* Shapes that are locked in a game before it is stopped */
+#define MAXPIECES 1000
+
+/* Rows a shape covers at most, from the bottom of the board up */
+#define BOTTOM	(NUMROWS - 3)
+#define TOP		(BOTTOM - NUMBLOCKS + 1)
+
+/*
+ * Type definitions
+ */
+
+typedef struct
+{
+   const char *name;
+   void (*setup)(int n);	/* prepare operation n (not timed) */
+   void (*run)(int n);		/* operation n */
+   int batch;				/* operations in a batch */
+} bench_t;
+
+typedef struct
+{
+   double ns;				/* nanoseconds per operation */
+   double cycles;			/* time stamp counter ticks per operation (0 if there is none) */
+} result_t;
+
+/*
+ * Global variables
+ */
+
+static int mintime = 200;
+static int tolerance = 10;
+static const char *baseline;
+
+/* Engines set up for the next batch, and the ones the batch works on */
+static engine_t pristine[BATCH],work[BATCH];
+
+/* Arguments of allowed() */
+static struct
+{
+   const orient_t *orient;
+   int x,y;
+} position[BATCH];
+
+/* Number of full rows droplines() finds (set by the benchmark) */
+static int fullrows;
+
+/* Keeps the compiler from optimizing the operations away */
+static volatile int sink;
+
+/*
+ * Functions
+ */
+
+/* Convert a string to integer. Returns TRUE if successful, FALSE otherwise. */
+static bool strtoint(int *i, const char *str)
+{
+   char *endptr;
+   long val = strtol(str, &endptr, 0);
+   if (*str == '\0' || *endptr != '\0' || val == LONG_MIN || val == LONG_MAX || val < INT_MIN || val > INT_MAX) return FALSE;
+   *i = (int)val;
+   return TRUE;
+}
+
+static int64_t now()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Same as the score function in tint at level 1 */
+static void score_function(engine_t *engine, void *userdata)
+{
+   engine->score += 2 * (engine->status.dropcount + 1);
+}
+
+/* Rotate the current shape and move it to a column, both chosen at random */
+static void place(engine_t *engine, uint64_t *state)
+{
+   int i,x = 1 + rand_value(state, NUMCOLS - 3);
+   for (i = rand_value(state, NUMORIENTS); i > 0; i--) engine_move(engine, ACTION_ROTATE);
+   for (i = 0; i < NUMCOLS && engine->curx < x; i++) engine_move(engine, ACTION_RIGHT);
+   for (i = 0; i < NUMCOLS && engine->curx > x; i++) engine_move(engine, ACTION_LEFT);
+}
+
+/* Play a game from seed with shapes dropped at random, until it is over or maxpieces were locked. Returns the number of shapes */
+static int play(engine_t *engine, uint64_t seed, int maxpieces)
+{
+   uint64_t state = seed;
+   int status,pieces = 0;
+   engine_init(engine, score_function, NULL, seed);
+   while (pieces < maxpieces)
+	 {
+		place(engine, &state);
+		engine_move(engine, ACTION_DROP);
+		while ((status = engine_evaluate(engine)) > 0) ;
+		if (status < 0) break;
+		pieces++;
+	 }
+   return pieces;
+}
+
+/* A board from game n with a new shape in the air (some shapes locked, none too high) */
+static void board(engine_t *engine, int n)
+{
+   uint64_t state = n;
+   do play(engine, rand_next(&state), rand_value(&state, 20));
+   while (shape_bottom(&engine->board, &SHAPES[engine->curshape].orient[engine->curorient], engine->curx, engine->cury));
+}
+
+/*
+ * Benchmarks
+ */
+
+static void setup_board(int n)
+{
+   board(&pristine[n], n);
+}
+
+static void setup_allowed(int n)
+{
+   uint64_t state = n + BATCH;
+   const shape_t *shape;
+   board(&pristine[n], n);
+   shape = &SHAPES[rand_value(&state, NUMSHAPES)];
+   position[n].orient = &shape->orient[rand_value(&state, shape->orients)];
+   position[n].x = 1 + rand_value(&state, NUMCOLS - 3);
+   position[n].y = rand_value(&state, NUMROWS - (position[n].orient->bottom - position[n].orient->top)) - position[n].orient->top;
+}
+
+static void run_allowed(int n)
+{
+   sink += allowed(&work[n].board, position[n].orient, position[n].x, position[n].y);
+}
+
+/* A shape moved around a bit in the air */
+static void setup_move(int n)
+{
+   uint64_t state = n + BATCH;
+   board(&pristine[n], n);
+   place(&pristine[n], &state);
+}
+
+static void run_left(int n)
+{
+   engine_move(&work[n], ACTION_LEFT);
+}
+
+static void run_rotate(int n)
+{
+   engine_move(&work[n], ACTION_ROTATE);
+}
+
+static void run_right(int n)
+{
+   engine_move(&work[n], ACTION_RIGHT);
+}
+
+static void run_drop(int n)
+{
+   engine_move(&work[n], ACTION_DROP);
+}
+
+static void run_down(int n)
+{
+   engine_move(&work[n], ACTION_DOWN);
+}
+
+static void run_evaluate(int n)
+{
+   sink += engine_evaluate(&work[n]);
+}
+
+/* A shape that is about to be locked */
+static void setup_lock(int n)
+{
+   setup_move(n);
+   engine_move(&pristine[n], ACTION_DROP);
+}
+
+/* A board with fullrows full rows near the bottom (those a shape covers) */
+static void setup_droplines(int n)
+{
+   uint64_t state = n + BATCH;
+   int i,y;
+   board(&pristine[n], n);
+   for (y = TOP; y <= BOTTOM; y++)
+	 if (pristine[n].board.row[y] == FULLROW)
+	   pristine[n].board.row[y] &= ~(1 << (1 + rand_value(&state, NUMCOLS - 3)));
+   for (i = 0; i < fullrows; i++)
+	 {
+		do y = TOP + rand_value(&state, NUMBLOCKS);
+		while (pristine[n].board.row[y] == FULLROW);
+		pristine[n].board.row[y] = FULLROW;
+	 }
+   measure(&pristine[n].board);
+}
+
+static void run_droplines(int n)
+{
+   sink += droplines(&work[n].board, TOP, BOTTOM);
+}
+
+static void setup_nothing(int n)
+{
+}
+
+static void run_init(int n)
+{
+   engine_init(&work[n], score_function, NULL, n);
+}
+
+static void run_game(int n)
+{
+   sink += play(&work[n], n, MAXPIECES);
+}
+
+static void setup_droplines0(int n) { fullrows = 0; setup_droplines(n); }
+static void setup_droplines1(int n) { fullrows = 1; setup_droplines(n); }
+static void setup_droplines2(int n) { fullrows = 2; setup_droplines(n); }
+static void setup_droplines3(int n) { fullrows = 3; setup_droplines(n); }
+static void setup_droplines4(int n) { fullrows = 4; setup_droplines(n); }
+
+static const bench_t benchmarks[] =
+{
+   { "allowed",         setup_allowed,    run_allowed,   BATCH },
+   { "move_left",       setup_move,       run_left,      BATCH },
+   { "move_rotate",     setup_move,       run_rotate,    BATCH },
+   { "move_right",      setup_move,       run_right,     BATCH },
+   { "move_drop",       setup_move,       run_drop,      BATCH },
+   { "move_down",       setup_move,       run_down,      BATCH },
+   { "evaluate_fall",   setup_board,      run_evaluate,  BATCH },
+   { "evaluate_lock",   setup_lock,       run_evaluate,  BATCH },
+   { "droplines_0",     setup_droplines0, run_droplines, BATCH },
+   { "droplines_1",     setup_droplines1, run_droplines, BATCH },
+   { "droplines_2",     setup_droplines2, run_droplines, BATCH },
+   { "droplines_3",     setup_droplines3, run_droplines, BATCH },
+   { "droplines_4",     setup_droplines4, run_droplines, BATCH },
+   { "engine_init",     setup_nothing,    run_init,      BATCH },
+   { "game",            setup_nothing,    run_game,      BATCH / 16 },
+   { NULL, NULL, NULL, 0 }
+};
+
+/* Run a benchmark in batches for at least mintime milliseconds. The fastest batch counts, the others were interrupted more */
+static void measurebench(const bench_t *bench, result_t *result)
+{
+   int64_t elapsed,total = 0,start;
+   uint64_t cycles,first;
+   int i;
+   result->ns = result->cycles = 0;
+   for (i = 0; i < bench->batch; i++) bench->setup(i);
+   do
+	 {
+		memcpy(work, pristine, bench->batch * sizeof(engine_t));
+		start = now();
+		first = CYCLES();
+		for (i = 0; i < bench->batch; i++) bench->run(i);
+		cycles = CYCLES() - first;
+		elapsed = now() - start;
+		if (!result->ns || (double) elapsed / bench->batch < result->ns)
+		  {
+			 result->ns = (double) elapsed / bench->batch;
+			 result->cycles = (double) cycles / bench->batch;
+		  }
+		total += elapsed;
+	 }
+   while (total < (int64_t) mintime * 1000000);
+}
+
+/* Find a benchmark in the baseline. Returns its ns/op, or 0 if it isn't there */
+static double lookup(FILE *fp, const char *name)
+{
+   char line[256],found[64];
+   double ns;
+   rewind(fp);
+   while (fgets(line, sizeof(line), fp) != NULL)
+	 if (line[0] != '#' && sscanf(line, "%63s %lf", found, &ns) == 2 && strcmp(found, name) == 0) return ns;
+   return 0;
+}
+
+static void showhelp()
+{
+   fprintf(stderr, "USAGE: tint-bench [-h] [-m milliseconds] [-c baseline] [-t tolerance]\n");
+   fprintf(stderr, "  -h           Show this help message\n");
+   fprintf(stderr, "  -m <ms>      Run each benchmark for at least this long (default %d)\n", mintime);
+   fprintf(stderr, "  -c <file>    Compare with a baseline (the output of an earlier run)\n");
+   fprintf(stderr, "  -t <percent> How much slower than the baseline is still fine (default %d)\n", tolerance);
+   exit(EXIT_FAILURE);
+}
+
+static void parse_options(int argc, char *argv[])
+{
+   int i = 1;
+   while (i < argc)
+	 {
+		if (strcmp(argv[i], "-h") == 0) showhelp();
+		if (i + 1 >= argc) showhelp();
+		if (strcmp(argv[i], "-m") == 0)
+		  {
+			 if (!strtoint(&mintime, argv[++i]) || mintime < 1) showhelp();
+		  }
+		else if (strcmp(argv[i], "-t") == 0)
+		  {
+			 if (!strtoint(&tolerance, argv[++i]) || tolerance < 0) showhelp();
+		  }
+		else if (strcmp(argv[i], "-c") == 0)
+		  baseline = argv[++i];
+		else
+		  {
+			 fprintf(stderr, "Invalid option -- %s\n", argv[i]);
+			 showhelp();
+		  }
+		i++;
+	 }
+}
+
+int main(int argc, char *argv[])
+{
+   const bench_t *bench;
+   result_t result;
+   FILE *fp = NULL;
+   double before;
+   int slower = 0;
+   parse_options(argc, argv);
+   if (baseline != NULL && (fp = fopen(baseline, "r")) == NULL)
+	 {
+		fprintf(stderr, "Can't open %s\n", baseline);
+		exit(EXIT_FAILURE);
+	 }
+   printf("# %-14s %12s %14s %12s\n", "benchmark", "ns/op", "ops/sec", "cycles/op");
+   for (bench = benchmarks; bench->name != NULL; bench++)
+	 {
+		measurebench(bench, &result);
+		printf("%-16s %12.2f %14.0f %12.1f\n", bench->name, result.ns, 1e9 / result.ns, result.cycles);
+		fflush(stdout);
+		if (fp != NULL && (before = lookup(fp, bench->name)) > 0 && result.ns > before * (100 + tolerance) / 100)
+		  {
+			 fprintf(stderr, "%s: %.2f ns/op is %.0f%% slower than the baseline (%.2f ns/op)\n",
+					 bench->name, result.ns, (result.ns / before - 1) * 100, before);
+			 slower++;
+		  }
+	 }
+   if (fp != NULL) fclose(fp);
+   exit(slower ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,166 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Thin client for tint-server: attaches the terminal to a game on the
+ * server. Keys go to the server as they are typed and whatever the server
+ * sends is written to the terminal as it is. The server does all the rest.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "typedefs.h"
+
+/* Where the server listens if -s isn't given (same as tint-server) */
+#define DEFAULTSOCKET	"/tmp/tint.sock"
+
+/* Size of the buffers */
+#define BUFSIZE	4096
+
+static const char *socketfile = DEFAULTSOCKET;
+
+/* Terminal settings before we started */
+static struct termios oldtermios;
+
+/* The terminal changed size */
+static volatile sig_atomic_t resized;
+
+/* Write all of buf to fd. Returns OK or ERR */
+static int writeall(int fd, const char *buf, int len)
+{
+   int n;
+   while (len > 0)
+	 {
+		if ((n = write(fd, buf, len)) < 0)
+		  {
+			 if (errno == EINTR) continue;
+			 return ERR;
+		  }
+		buf += n;
+		len -= n;
+	 }
+   return OK;
+}
+
+static void showhelp()
+{
+   fprintf(stderr, "USAGE: tint-client [-h] [-s socket]\n");
+   fprintf(stderr, "  -h           Show this help message\n");
+   fprintf(stderr, "  -s <socket>  Socket tint-server listens on (default %s)\n", DEFAULTSOCKET);
+   exit(EXIT_FAILURE);
+}
+
+static void parse_options(int argc, char *argv[])
+{
+   int i = 1;
+   while (i < argc)
+	 {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		  socketfile = argv[++i];
+		else
+		  showhelp();
+		i++;
+	 }
+}
+
+static void resize(int sig)
+{
+   resized = TRUE;
+}
+
+/* Connect to the server. Returns the socket or ERR */
+static int connect_server()
+{
+   struct sockaddr_un addr;
+   int fd;
+   if (strlen(socketfile) >= sizeof(addr.sun_path))
+	 {
+		errno = ENAMETOOLONG;
+		return ERR;
+	 }
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, socketfile);
+   if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return ERR;
+   if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	 {
+		close(fd);
+		return ERR;
+	 }
+   return fd;
+}
+
+int main(int argc, char *argv[])
+{
+   struct pollfd pfd[2];
+   struct termios termios;
+   struct sigaction sa;
+   char buf[BUFSIZE];
+   int fd,n;
+   parse_options(argc, argv);
+   if ((fd = connect_server()) == ERR)
+	 {
+		fprintf(stderr, "Can't connect to %s: %s\n", socketfile, strerror(errno));
+		exit(EXIT_FAILURE);
+	 }
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = resize;
+   sigaction(SIGWINCH, &sa, NULL);
+   signal(SIGPIPE, SIG_IGN);
+   /* keys are sent as they are typed, like the ansi backend of tint */
+   if (tcgetattr(STDIN_FILENO, &oldtermios) == 0)
+	 {
+		termios = oldtermios;
+		termios.c_lflag &= ~(ICANON | ECHO);
+		termios.c_cc[VMIN] = 1;
+		termios.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &termios);
+	 }
+   /* switch to the alternate screen and hide the cursor */
+   writeall(STDOUT_FILENO, "\033[?1049h\033[?25l", 14);
+   pfd[0].fd = STDIN_FILENO;
+   pfd[0].events = POLLIN;
+   pfd[1].fd = fd;
+   pfd[1].events = POLLIN;
+   for (;;)
+	 {
+		/* ask the server to draw everything again (the terminal was cleared or it moved things) */
+		if (resized)
+		  {
+			 resized = FALSE;
+			 if (writeall(fd, "\f", 1) != OK) break;
+		  }
+		if (poll(pfd, 2, -1) < 0)
+		  {
+			 if (errno == EINTR) continue;
+			 break;
+		  }
+		if (pfd[0].revents & (POLLIN | POLLHUP))
+		  {
+			 if ((n = read(STDIN_FILENO, buf, sizeof(buf))) <= 0 || writeall(fd, buf, n) != OK) break;
+		  }
+		if (pfd[1].revents & (POLLIN | POLLHUP | POLLERR))
+		  {
+			 if ((n = read(fd, buf, sizeof(buf))) <= 0 || writeall(STDOUT_FILENO, buf, n) != OK) break;
+		  }
+	 }
+   /* the game is over (or the server is gone) */
+   close(fd);
+   writeall(STDOUT_FILENO, "\033[0m\033[2J\033[?25h\033[?1049l", 22);
+   tcsetattr(STDIN_FILENO, TCSANOW, &oldtermios);
+   exit(EXIT_SUCCESS);
+}
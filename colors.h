@@ -0,0 +1,25 @@
+#ifndef COLORS_H
+#define COLORS_H
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Colors
+ */
+
+#define COLOR_BLACK     0                        /* Black */
+#define COLOR_RED       1                        /* Red */
+#define COLOR_GREEN     2                        /* Green */
+#define COLOR_YELLOW    3                        /* Yellow */
+#define COLOR_BLUE      4                        /* Blue */
+#define COLOR_MAGENTA   5                        /* Magenta */
+#define COLOR_CYAN      6                        /* Cyan */
+#define COLOR_WHITE     7                        /* White */
+
+#endif	/* #ifndef COLORS_H */
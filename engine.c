@@ -9,25 +9,108 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 #include "typedefs.h"
-#include "io.h"
+#include "colors.h"
 #include "engine.h"
 
+/*
+ * Profiling. Built with -DENGINE_PROFILE, the functions below count how
+ * often they are called and the cycles spent in them (including the
+ * functions they call). Otherwise the macros are empty and cost nothing.
+ */
+
+#ifdef ENGINE_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>		/* __rdtsc() */
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+/* Names of the profiled functions (in the same order as profile_t) */
+static const char *profilename[NUMPROFILES] =
+{
+   "allowed", "shape_left", "shape_right", "shape_rotate", "shape_down",
+   "shape_bottom", "shape_drop", "droplines", "rand_value"
+};
+
+/* Counters (per thread, so that threads don't fight over them) */
+static __thread struct
+{
+   uint64_t calls,cycles;
+} profile[NUMPROFILES];
+
+#define PROFILE_ENTER(n)		uint64_t profile_start = CYCLES()
+#define PROFILE_LEAVE(n)		(profile[n].calls++, profile[n].cycles += CYCLES() - profile_start)
+#define PROFILE_RETURN(n,value)	do { __typeof__(value) profile_result = (value); PROFILE_LEAVE(n); return profile_result; } while (0)
+
+#else	/* #ifdef ENGINE_PROFILE */
+
+#define PROFILE_ENTER(n)
+#define PROFILE_LEAVE(n)
+#define PROFILE_RETURN(n,value)	return (value)
+
+#endif	/* #ifdef ENGINE_PROFILE */
+
 /*
  * Global variables
  */
 
+/* Every orientation of every shape, as produced by rotating the shapes the */
+/* way tetris likes it (= not mathematically correct): shape 0 is rotated */
+/* anti-clockwise and back, shapes 1 and 6 clockwise and back, shapes 2, 4 */
+/* and 5 anti-clockwise all the way around and shape 3 is not rotated at all */
 const shapes_t SHAPES =
 {
-   { COLOR_CYAN,    0, FALSE, { {  1,  0 }, {  0,  0 }, {  0, -1 }, { -1, -1 } } },
-   { COLOR_GREEN,   1, FALSE, { {  1, -1 }, {  0, -1 }, {  0,  0 }, { -1,  0 } } },
-   { COLOR_YELLOW,  2, FALSE, { { -1,  0 }, {  0,  0 }, {  1,  0 }, {  0,  1 } } },
-   { COLOR_BLUE,    3, FALSE, { { -1, -1 }, {  0, -1 }, { -1,  0 }, {  0,  0 } } },
-   { COLOR_MAGENTA, 4, FALSE, { { -1,  1 }, { -1,  0 }, {  0,  0 }, {  1,  0 } } },
-   { COLOR_WHITE,   5, FALSE, { {  1,  1 }, {  1,  0 }, {  0,  0 }, { -1,  0 } } },
-   { COLOR_RED,     6, FALSE, { { -1,  0 }, {  0,  0 }, {  1,  0 }, {  2,  0 } } }
+   { COLOR_CYAN, 2,
+	  {
+		  { { {  1,  0 }, {  0,  0 }, {  0, -1 }, { -1, -1 } }, -1,  1, -1,  0, { 0x03, 0x06, 0x00, 0x00 }, { -1,  0,  0,  0 } },
+		  { { {  0, -1 }, {  0,  0 }, { -1,  0 }, { -1,  1 } }, -1,  0, -1,  1, { 0x02, 0x03, 0x01, 0x00 }, {  1,  0,  0,  0 } }
+	  }
+   },
+   { COLOR_GREEN, 2,
+	  {
+		  { { {  1, -1 }, {  0, -1 }, {  0,  0 }, { -1,  0 } }, -1,  1, -1,  0, { 0x06, 0x03, 0x00, 0x00 }, {  0,  0, -1,  0 } },
+		  { { {  1,  1 }, {  1,  0 }, {  0,  0 }, {  0, -1 } },  0,  1, -1,  1, { 0x02, 0x06, 0x04, 0x00 }, {  0,  1,  0,  0 } }
+	  }
+   },
+   { COLOR_YELLOW, 4,
+	  {
+		  { { { -1,  0 }, {  0,  0 }, {  1,  0 }, {  0,  1 } }, -1,  1,  0,  1, { 0x07, 0x02, 0x00, 0x00 }, {  0,  1,  0,  0 } },
+		  { { {  0,  1 }, {  0,  0 }, {  0, -1 }, {  1,  0 } },  0,  1, -1,  1, { 0x02, 0x06, 0x02, 0x00 }, {  1,  0,  0,  0 } },
+		  { { {  1,  0 }, {  0,  0 }, { -1,  0 }, {  0, -1 } }, -1,  1, -1,  0, { 0x02, 0x07, 0x00, 0x00 }, {  0,  0,  0,  0 } },
+		  { { {  0, -1 }, {  0,  0 }, {  0,  1 }, { -1,  0 } }, -1,  0, -1,  1, { 0x02, 0x03, 0x02, 0x00 }, {  0,  1,  0,  0 } }
+	  }
+   },
+   { COLOR_BLUE, 1,
+	  {
+		  { { { -1, -1 }, {  0, -1 }, { -1,  0 }, {  0,  0 } }, -1,  0, -1,  0, { 0x03, 0x03, 0x00, 0x00 }, {  0,  0,  0,  0 } }
+	  }
+   },
+   { COLOR_MAGENTA, 4,
+	  {
+		  { { { -1,  1 }, { -1,  0 }, {  0,  0 }, {  1,  0 } }, -1,  1,  0,  1, { 0x07, 0x01, 0x00, 0x00 }, {  1,  0,  0,  0 } },
+		  { { {  1,  1 }, {  0,  1 }, {  0,  0 }, {  0, -1 } },  0,  1, -1,  1, { 0x02, 0x02, 0x06, 0x00 }, {  1,  1,  0,  0 } },
+		  { { {  1, -1 }, {  1,  0 }, {  0,  0 }, { -1,  0 } }, -1,  1, -1,  0, { 0x04, 0x07, 0x00, 0x00 }, {  0,  0,  0,  0 } },
+		  { { { -1, -1 }, {  0, -1 }, {  0,  0 }, {  0,  1 } }, -1,  0, -1,  1, { 0x03, 0x02, 0x02, 0x00 }, { -1,  1,  0,  0 } }
+	  }
+   },
+   { COLOR_WHITE, 4,
+	  {
+		  { { {  1,  1 }, {  1,  0 }, {  0,  0 }, { -1,  0 } }, -1,  1,  0,  1, { 0x07, 0x04, 0x00, 0x00 }, {  0,  0,  1,  0 } },
+		  { { {  1, -1 }, {  0, -1 }, {  0,  0 }, {  0,  1 } },  0,  1, -1,  1, { 0x06, 0x02, 0x02, 0x00 }, {  1, -1,  0,  0 } },
+		  { { { -1, -1 }, { -1,  0 }, {  0,  0 }, {  1,  0 } }, -1,  1, -1,  0, { 0x01, 0x07, 0x00, 0x00 }, {  0,  0,  0,  0 } },
+		  { { { -1,  1 }, {  0,  1 }, {  0,  0 }, {  0, -1 } }, -1,  0, -1,  1, { 0x02, 0x02, 0x03, 0x00 }, {  1,  1,  0,  0 } }
+	  }
+   },
+   { COLOR_RED, 2,
+	  {
+		  { { { -1,  0 }, {  0,  0 }, {  1,  0 }, {  2,  0 } }, -1,  2,  0,  0, { 0x0f, 0x00, 0x00, 0x00 }, {  0,  0,  0,  0 } },
+		  { { {  0, -1 }, {  0,  0 }, {  0,  1 }, {  0,  2 } },  0,  0, -1,  2, { 0x02, 0x02, 0x02, 0x02 }, {  2,  0,  0,  0 } }
+	  }
+   }
 };
 
 /*
@@ -35,243 +118,223 @@ const shapes_t SHAPES =
  */
 
 /*
- * Initialize random number generator
+ * Generate the next random number (splitmix64). The state is kept in the
+ * engine, so engines don't share (or fight over) a generator and a game can
+ * be reproduced from its seed.
  */
-static void rand_init()
+static uint32_t rand_next(uint64_t *state)
 {
-#ifdef USE_RAND
-   srand(time(NULL));
-#else
-   srandom(time(NULL));
-#endif
+   uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return (uint32_t) ((z ^ (z >> 31)) >> 32);
 }
 
 /*
  * Generate a random number within range
  */
-static int rand_value(int range)
+static int rand_value(uint64_t *state, int range)
 {
-#ifdef USE_RAND
-   return ((int) ((float) range * rand() / (RAND_MAX + 1.0)));
-#else
-   return (random() % range);
-#endif
+   PROFILE_ENTER(PROFILE_RAND_VALUE);
+   PROFILE_RETURN(PROFILE_RAND_VALUE, (int) (((uint64_t) rand_next(state) * range) >> 32));
 }
 
 /*
  * Functions
  */
 
-/* This rotates a shape */
-static void real_rotate(shape_t *shape, bool clockwise)
-{
-   int i,tmp;
-   if (clockwise)
-	 {
-		for (i = 0; i < NUMBLOCKS; i++)
-		  {
-			 tmp = shape->block[i].x;
-			 shape->block[i].x = -shape->block[i].y;
-			 shape->block[i].y = tmp;
-		  }
-	 }
-   else
-	 {
-		for (i = 0; i < NUMBLOCKS; i++)
-		  {
-			 tmp = shape->block[i].x;
-			 shape->block[i].x = shape->block[i].y;
-			 shape->block[i].y = -tmp;
-		  }
-	 }
-}
-
-/* Rotate shapes the way tetris likes it (= not mathematically correct) */
-static void fake_rotate(shape_t *shape)
-{
-   switch (shape->type)
-	 {
-	  case 0:	/* Just rotate this one anti-clockwise and clockwise */
-		if (shape->flipped) real_rotate(shape, TRUE); else real_rotate(shape, FALSE);
-		shape->flipped = !shape->flipped;
-		break;
-	  case 1:	/* Just rotate these two clockwise and anti-clockwise */
-	  case 6:
-		if (shape->flipped) real_rotate(shape, FALSE); else real_rotate(shape, TRUE);
-		shape->flipped = !shape->flipped;
-		break;
-	  case 2:	/* Rotate these three anti-clockwise */
-	  case 4:
-	  case 5:
-		real_rotate(shape, FALSE);
-		break;
-	  case 3:	/* This one is not rotated at all */
-		break;
-	 }
-}
+/* Blocks of a shape row (from orient_t.mask) positioned on a board row at column x */
+#define ROWMASK(mask,x) (((unsigned int) (mask) << (x)) >> 1)
 
 /* Draw a shape on the board */
-static void drawshape(board_t board, shape_t *shape, int x, int y)
+static void drawshape(board_t *board, int color, const orient_t *orient, int x, int y)
 {
    int i;
-   for (i = 0; i < NUMBLOCKS; i++) board[x + shape->block[i].x][y + shape->block[i].y] = shape->color;
-}
-
-/* Erase a shape from the board */
-static void eraseshape(board_t board, shape_t *shape, int x, int y)
-{
-   int i;
-   for (i = 0; i < NUMBLOCKS; i++) board[x + shape->block[i].x][y + shape->block[i].y] = COLOR_BLACK;
+   for (i = 0; i < NUMBLOCKS; i++)
+	 {
+		board->row[y + orient->block[i].y] |= 1 << (x + orient->block[i].x);
+		board->color[y + orient->block[i].y][x + orient->block[i].x] = color;
+	 }
 }
 
 /* Check if shape is allowed to be in this position */
-static bool allowed(board_t board, shape_t *shape, int x, int y)
+static bool allowed(const board_t *board, const orient_t *orient, int x, int y)
 {
-   int i, occupied = FALSE;
-   for (i = 0; i < NUMBLOCKS; i++) if (board[x + shape->block[i].x][y + shape->block[i].y]) occupied = TRUE;
-   return (!occupied);
+   int i;
+   PROFILE_ENTER(PROFILE_ALLOWED);
+   for (i = 0; i <= orient->bottom - orient->top; i++)
+	 if (board->row[y + orient->top + i] & ROWMASK(orient->mask[i], x)) PROFILE_RETURN(PROFILE_ALLOWED, FALSE);
+   PROFILE_RETURN(PROFILE_ALLOWED, TRUE);
 }
 
 /* Move the shape left if possible */
-static bool shape_left(board_t board, shape_t *shape, int *x, int y)
+static bool shape_left(const board_t *board, const orient_t *orient, int *x, int y)
 {
-   bool result = FALSE;
-   eraseshape(board, shape, *x, y);
-   if (allowed(board, shape, *x - 1, y))
-	 {
-		(*x)--;
-		result = TRUE;
-	 }
-   drawshape(board, shape, *x, y);
-   return result;
+   PROFILE_ENTER(PROFILE_SHAPE_LEFT);
+   if (!allowed(board, orient, *x - 1, y)) PROFILE_RETURN(PROFILE_SHAPE_LEFT, FALSE);
+   (*x)--;
+   PROFILE_RETURN(PROFILE_SHAPE_LEFT, TRUE);
 }
 
 /* Move the shape right if possible */
-static bool shape_right(board_t board, shape_t *shape, int *x, int y)
+static bool shape_right(const board_t *board, const orient_t *orient, int *x, int y)
 {
-   bool result = FALSE;
-   eraseshape(board, shape, *x, y);
-   if (allowed(board, shape, *x + 1, y))
-	 {
-		(*x)++;
-		result = TRUE;
-	 }
-   drawshape(board, shape, *x, y);
-   return result;
+   PROFILE_ENTER(PROFILE_SHAPE_RIGHT);
+   if (!allowed(board, orient, *x + 1, y)) PROFILE_RETURN(PROFILE_SHAPE_RIGHT, FALSE);
+   (*x)++;
+   PROFILE_RETURN(PROFILE_SHAPE_RIGHT, TRUE);
 }
 
 /* Rotate the shape if possible */
-static bool shape_rotate(board_t board, shape_t *shape, int x, int y)
+static bool shape_rotate(const board_t *board, const shape_t *shape, int *orient, int x, int y)
 {
-   bool result = FALSE;
-   shape_t test;
-   eraseshape(board, shape, x, y);
-   memcpy(&test, shape, sizeof(shape_t));
-   fake_rotate(&test);
-   if (allowed(board, &test, x, y))
-	 {
-		memcpy(shape, &test, sizeof(shape_t));
-		result = TRUE;
-	 }
-   drawshape (board,shape,x,y);
-   return result;
+   int next = (*orient + 1) % shape->orients;
+   PROFILE_ENTER(PROFILE_SHAPE_ROTATE);
+   if (!allowed(board, &shape->orient[next], x, y)) PROFILE_RETURN(PROFILE_SHAPE_ROTATE, FALSE);
+   *orient = next;
+   PROFILE_RETURN(PROFILE_SHAPE_ROTATE, TRUE);
 }
 
 /* Move the shape one row down if possible */
-static bool shape_down(board_t board, shape_t *shape, int x, int *y)
+static bool shape_down(const board_t *board, const orient_t *orient, int x, int *y)
 {
-   bool result = FALSE;
-   eraseshape (board,shape,x,*y);
-   if (allowed(board, shape, x, *y + 1))
-	 {
-		(*y)++;
-		result = TRUE;
-	 }
-   drawshape (board,shape,x,*y);
-   return result;
+   PROFILE_ENTER(PROFILE_SHAPE_DOWN);
+   if (!allowed(board, orient, x, *y + 1)) PROFILE_RETURN(PROFILE_SHAPE_DOWN, FALSE);
+   (*y)++;
+   PROFILE_RETURN(PROFILE_SHAPE_DOWN, TRUE);
 }
 
 /* Check if shape can move down (= in the air) or not (= at the bottom */
 /* of the board or on top of one of the resting shapes) */
-static bool shape_bottom(board_t board, shape_t *shape, int x, int y)
+static bool shape_bottom(const board_t *board, const orient_t *orient, int x, int y)
 {
-   bool result = FALSE;
-   eraseshape(board, shape, x, y);
-   result = !allowed(board, shape, x, y + 1);
-   drawshape (board,shape,x,y);
-   return result;
+   PROFILE_ENTER(PROFILE_SHAPE_BOTTOM);
+   PROFILE_RETURN(PROFILE_SHAPE_BOTTOM, !allowed(board, orient, x, y + 1));
 }
 
 /* Drop the shape until it comes to rest on the bottom of the board or */
 /* on top of a resting shape */
-static int shape_drop(board_t board, shape_t *shape, int x, int *y)
+static int shape_drop(const board_t *board, const orient_t *orient, int x, int *y)
 {
-   int droppedlines = 0;
-   eraseshape (board,shape,x,*y);
-   while (allowed(board, shape, x, *y + 1))
+   int i,surface,distance,droppedlines = NUMROWS;
+   PROFILE_ENTER(PROFILE_SHAPE_DROP);
+   /* If every column of the shape is above the surface of the board, the */
+   /* column closest to the surface decides how far the shape can fall */
+   for (i = 0; i <= orient->right - orient->left; i++)
+	 {
+		surface = NUMROWS - 2 - board->height[x + orient->left + i];
+		distance = surface - 1 - (*y + orient->lowest[i]);
+		if (distance < 0) break;
+		if (distance < droppedlines) droppedlines = distance;
+	 }
+   if (i > orient->right - orient->left)
+	 {
+		*y += droppedlines;
+		PROFILE_RETURN(PROFILE_SHAPE_DROP, droppedlines);
+	 }
+   /* Otherwise the shape is under an overhang, so find out the hard way */
+   droppedlines = 0;
+   while (allowed(board, orient, x, *y + 1))
 	 {
 		(*y)++;
 		droppedlines++;
 	 }
-   drawshape (board,shape,x,*y);
-   return droppedlines;
+   PROFILE_RETURN(PROFILE_SHAPE_DROP, droppedlines);
 }
 
-/* This removes all the rows on the board that is completely filled with blocks */
-static int droplines(board_t board)
+/* Lock a shape into the board */
+static void lockshape(board_t *board, int color, const orient_t *orient, int x, int y)
 {
-   int i,x,y,ny,status,droppedlines;
-   board_t newboard;
-   /* initialize new board */
-   memset(newboard, 0, sizeof(board_t));
-   for (i = 0; i < NUMCOLS; i++) newboard[i][NUMROWS - 1] = newboard[i][NUMROWS - 2] = WALL;
-   for (i = 0; i < NUMROWS; i++) newboard[0][i] = newboard[NUMCOLS - 1][i] = newboard[NUMCOLS - 2][i] = WALL;
-   /* ... */
-   ny = NUMROWS - 3;
-   droppedlines = 0;
-   for (y = NUMROWS - 3; y > 0; y--)
+   int i;
+   drawshape(board, color, orient, x, y);
+   for (i = 0; i < NUMBLOCKS; i++)
+	 if (board->height[x + orient->block[i].x] < NUMROWS - 2 - (y + orient->block[i].y))
+	   board->height[x + orient->block[i].x] = NUMROWS - 2 - (y + orient->block[i].y);
+}
+
+/* Measure the height of the blocks in each column of the board */
+static void measure(board_t *board)
+{
+   int x,y;
+   for (x = 1; x < NUMCOLS - 2; x++)
+	 {
+		for (y = 0; y < NUMROWS - 2 && !(board->row[y] & (1 << x)); y++) ;
+		board->height[x] = NUMROWS - 2 - y;
+	 }
+}
+
+/* Clear a row, leaving only the walls */
+static void clearrow(board_t *board, int y)
+{
+   board->row[y] = WALLROW;
+   memset(board->color[y], COLOR_BLACK, NUMCOLS);
+   board->color[y][0] = board->color[y][NUMCOLS - 2] = board->color[y][NUMCOLS - 1] = WALL;
+}
+
+/* This removes the rows from top to bottom (the rows covered by the shape */
+/* that was locked last) that are completely filled with blocks */
+static int droplines(board_t *board, int top, int bottom)
+{
+   int y,ny,droppedlines = 0;
+   PROFILE_ENTER(PROFILE_DROPLINES);
+   /* the top row never keeps any blocks */
+   if (top <= 0)
+	 {
+		clearrow(board, 0);
+		measure(board);
+		top = 1;
+	 }
+   /* nothing to do unless one of the rows is full */
+   for (y = bottom; y >= top && board->row[y] != FULLROW; y--) ;
+   if (y < top) PROFILE_RETURN(PROFILE_DROPLINES, 0);
+   /* move the rows that aren't full down, overwriting the full ones */
+   for (ny = y; y > 0; y--)
 	 {
-		status = 0;
-		for (x = 1; x < NUMCOLS - 2; x++) if (board[x][y]) status++;
-		if (status < NUMCOLS - 3)
+		if (board->row[y] == FULLROW) droppedlines++;
+		else
 		  {
-			 for (x = 1; x < NUMCOLS - 2; x++) newboard[x][ny] = board[x][y];
+			 if (ny != y)
+			   {
+				  board->row[ny] = board->row[y];
+				  memcpy(board->color[ny], board->color[y], NUMCOLS);
+			   }
 			 ny--;
 		  }
-		else droppedlines++;
 	 }
-   memcpy(board, newboard, sizeof(board_t));
-   return droppedlines;
+   /* the rows above that are empty */
+   for (; ny >= 0; ny--) clearrow(board, ny);
+   measure(board);
+   PROFILE_RETURN(PROFILE_DROPLINES, droppedlines);
 }
 
 /*
- * Initialize specified tetris engine
+ * Initialize specified tetris engine. The sequence of shapes is determined
+ * by the seed, so the same seed and moves always give the same game. The
+ * score function is called with userdata whenever a shape is locked.
  */
-void engine_init(engine_t *engine, void (*score_function)(engine_t *))
+void engine_init(engine_t *engine, void (*score_function)(engine_t *,void *), void *userdata, uint64_t seed)
 {
    int i;
-   
-   /* Initialize random number generator on first call */
-   static bool rand_initialized = FALSE;
-   if (!rand_initialized) {
-      rand_init();
-      rand_initialized = TRUE;
-   }
-   
    engine->score_function = score_function;
+   engine->userdata = userdata;
+   engine->seed = seed;
    /* intialize values */
    engine->curx = 5;
    engine->cury = 1;
-   engine->curshape = rand_value(NUMSHAPES);
-   engine->nextshape = rand_value(NUMSHAPES);
+   engine->curshape = rand_value(&engine->seed, NUMSHAPES);
+   engine->nextshape = rand_value(&engine->seed, NUMSHAPES);
+   engine->curorient = 0;
    engine->score = 0;
    engine->status.moves = engine->status.rotations = engine->status.dropcount = engine->status.efficiency = engine->status.droppedlines = 0;
-   /* initialize shapes */
-   memcpy(engine->shapes, SHAPES, sizeof(shapes_t));
    /* initialize board */
-   memset(engine->board, 0, sizeof(board_t));
-   for (i = 0; i < NUMCOLS; i++) engine->board[i][NUMROWS - 1] = engine->board[i][NUMROWS - 2] = WALL;
-   for (i = 0; i < NUMROWS; i++) engine->board[0][i] = engine->board[NUMCOLS - 1][i] = engine->board[NUMCOLS - 2][i] = WALL;
+   for (i = 0; i < NUMROWS - 2; i++) clearrow(&engine->board, i);
+   for (i = NUMROWS - 2; i < NUMROWS; i++)
+	 {
+		engine->board.row[i] = FULLROW;
+		memset(engine->board.color[i], WALL, NUMCOLS);
+	 }
+   memset(engine->board.height, 0, NUMCOLS);
+   engine->board.height[0] = engine->board.height[NUMCOLS - 2] = engine->board.height[NUMCOLS - 1] = NUMROWS - 2;
 }
 
 /*
@@ -279,23 +342,28 @@ void engine_init(engine_t *engine, void (*score_function)(engine_t *))
  */
 void engine_move(engine_t *engine, action_t action)
 {
+   const orient_t *orient = &SHAPES[engine->curshape].orient[engine->curorient];
    switch (action)
 	 {
 		/* move shape to the left if possible */
 	  case ACTION_LEFT:
-		if (shape_left(engine->board, &engine->shapes[engine->curshape], &engine->curx, engine->cury)) engine->status.moves++;
+		if (shape_left(&engine->board, orient, &engine->curx, engine->cury)) engine->status.moves++;
 		break;
 		/* rotate shape if possible */
 	  case ACTION_ROTATE:
-		if (shape_rotate(engine->board, &engine->shapes[engine->curshape], engine->curx, engine->cury)) engine->status.rotations++;
+		if (shape_rotate(&engine->board, &SHAPES[engine->curshape], &engine->curorient, engine->curx, engine->cury)) engine->status.rotations++;
 		break;
 		/* move shape to the right if possible */
 	  case ACTION_RIGHT:
-		if (shape_right(engine->board, &engine->shapes[engine->curshape], &engine->curx, engine->cury)) engine->status.moves++;
+		if (shape_right(&engine->board, orient, &engine->curx, engine->cury)) engine->status.moves++;
 		break;
 		/* drop shape to the bottom */
 	  case ACTION_DROP:
-		engine->status.dropcount += shape_drop(engine->board, &engine->shapes[engine->curshape], engine->curx, &engine->cury);
+		engine->status.dropcount += shape_drop(&engine->board, orient, engine->curx, &engine->cury);
+		break;
+		/* move shape one row down if possible */
+	  case ACTION_DOWN:
+		shape_down(&engine->board, orient, engine->curx, &engine->cury);
 	 }
 }
 
@@ -309,12 +377,15 @@ void engine_move(engine_t *engine, action_t action)
  */
 int engine_evaluate(engine_t *engine)
 {
-   if (shape_bottom(engine->board, &engine->shapes[engine->curshape], engine->curx, engine->cury))
+   const orient_t *orient = &SHAPES[engine->curshape].orient[engine->curorient];
+   if (shape_bottom(&engine->board, orient, engine->curx, engine->cury))
 	 {
+		/* lock the shape into the board */
+		lockshape(&engine->board, SHAPES[engine->curshape].color, orient, engine->curx, engine->cury);
 		/* increase score */
-		engine->score_function(engine);
+		engine->score_function(engine, engine->userdata);
 		/* update status information */
-		engine->status.droppedlines += droplines(engine->board);
+		engine->status.droppedlines += droplines(&engine->board, engine->cury + orient->top, engine->cury + orient->bottom);
 		engine->curx -= 5;
 		engine->curx = abs(engine->curx);
 		engine->status.rotations = 4 - engine->status.rotations;
@@ -326,13 +397,218 @@ int engine_evaluate(engine_t *engine)
 		engine->curx = 5;
 		engine->cury = 1;
 		engine->curshape = engine->nextshape;
-		engine->nextshape = rand_value(NUMSHAPES);
-		/* initialize shapes */
-		memcpy(engine->shapes, SHAPES, sizeof(shapes_t));
+		engine->nextshape = rand_value(&engine->seed, NUMSHAPES);
+		engine->curorient = 0;
 		/* return games status */
-		return allowed(engine->board, &engine->shapes[engine->curshape], engine->curx, engine->cury) ? 0 : -1;
+		return allowed(&engine->board, &SHAPES[engine->curshape].orient[0], engine->curx, engine->cury) ? 0 : -1;
 	 }
-   shape_down(engine->board, &engine->shapes[engine->curshape], engine->curx, &engine->cury);
+   shape_down(&engine->board, orient, engine->curx, &engine->cury);
    return 1;
 }
 
+/* Index of a shape position in the placement search */
+#define STATE(x,y,orient) ((((orient) * NUMROWS) + (y)) * NUMCOLS + (x))
+
+/*
+ * Find every position where the current shape of the specified tetris engine
+ * can come to rest, using the same moves and collision rules as
+ * engine_move() and engine_evaluate(). The engine is not modified. Returns
+ * the number of placements (0 if the game is over).
+ */
+int engine_enumerate_placements(const engine_t *engine, placements_t *placements)
+{
+   const shape_t *shape = &SHAPES[engine->curshape];
+   const board_t *board = &engine->board;
+   short queue[NUMSTATES],depth[NUMSTATES];
+   int head = 0,tail = 0,state,next,action,x,y,orient;
+   placements->count = 0;
+   if (!allowed(board, &shape->orient[engine->curorient], engine->curx, engine->cury)) return 0;
+   memset(placements->parent, 0xff, sizeof(placements->parent));
+   /* breadth first search from the current position, so the first path found to a state is the shortest */
+   state = STATE(engine->curx, engine->cury, engine->curorient);
+   placements->parent[state] = state;
+   depth[state] = 0;
+   queue[tail++] = state;
+   while (head < tail)
+	 {
+		state = queue[head++];
+		x = state % NUMCOLS;
+		y = state / NUMCOLS % NUMROWS;
+		orient = state / (NUMCOLS * NUMROWS);
+		/* a shape that can't move down comes to rest here */
+		if (shape_bottom(board, &shape->orient[orient], x, y))
+		  {
+			 placement_t *placement = &placements->placement[placements->count++];
+			 placement->x = x;
+			 placement->y = y;
+			 placement->orient = orient;
+			 placement->moves = depth[state];
+		  }
+		for (action = ACTION_LEFT; action <= ACTION_DOWN; action++)
+		  {
+			 int nx = x,ny = y,norient = orient;
+			 bool moved = FALSE;
+			 switch (action)
+			   {
+				case ACTION_LEFT:
+				  moved = shape_left(board, &shape->orient[orient], &nx, ny);
+				  break;
+				case ACTION_ROTATE:
+				  moved = shape_rotate(board, shape, &norient, nx, ny) && norient != orient;
+				  break;
+				case ACTION_RIGHT:
+				  moved = shape_right(board, &shape->orient[orient], &nx, ny);
+				  break;
+				case ACTION_DROP:
+				  moved = shape_drop(board, &shape->orient[orient], nx, &ny) > 1;
+				  break;
+				case ACTION_DOWN:
+				  moved = shape_down(board, &shape->orient[orient], nx, &ny);
+				  break;
+			   }
+			 next = STATE(nx, ny, norient);
+			 if (!moved || placements->parent[next] >= 0) continue;
+			 placements->parent[next] = state;
+			 placements->action[next] = action;
+			 depth[next] = depth[state] + 1;
+			 queue[tail++] = next;
+		  }
+	 }
+   return placements->count;
+}
+
+/*
+ * Get the shortest sequence of actions that takes the current shape from
+ * where it is to the given placement. The path must have room for
+ * placement->moves actions. Returns the number of actions.
+ */
+int engine_placement_path(const placements_t *placements, const placement_t *placement, action_t *path)
+{
+   int i,state = STATE(placement->x, placement->y, placement->orient);
+   for (i = placement->moves - 1; i >= 0; i--)
+	 {
+		path[i] = placements->action[state];
+		state = placements->parent[state];
+	 }
+   return placement->moves;
+}
+
+/*
+ * Save the state of the specified tetris engine in a snapshot
+ */
+void engine_snapshot(const engine_t *engine, snapshot_t *snapshot)
+{
+   snapshot->seed = engine->seed;
+   snapshot->score = engine->score;
+   snapshot->status = engine->status;
+   memcpy(snapshot->row, engine->board.row, sizeof(snapshot->row));
+   memcpy(snapshot->height, engine->board.height + 1, sizeof(snapshot->height));
+   snapshot->curx = engine->curx;
+   snapshot->cury = engine->cury;
+   snapshot->curshape = engine->curshape;
+   snapshot->nextshape = engine->nextshape;
+   snapshot->curorient = engine->curorient;
+}
+
+/*
+ * Check that a snapshot is one engine_snapshot() could have made: the
+ * shapes and orientation exist, every block of the current shape is on the
+ * board, the rows have their walls and the heights agree with the rows.
+ * Returns TRUE if it is
+ */
+bool engine_check(const snapshot_t *snapshot)
+{
+   const orient_t *orient;
+   int i,x,y;
+   if (snapshot->curshape < 0 || snapshot->curshape >= NUMSHAPES ||
+	   snapshot->nextshape < 0 || snapshot->nextshape >= NUMSHAPES ||
+	   snapshot->curorient < 0 || snapshot->curorient >= SHAPES[snapshot->curshape].orients)
+	 return FALSE;
+   /* the shape has to be between the walls and above the floor */
+   orient = &SHAPES[snapshot->curshape].orient[snapshot->curorient];
+   for (i = 0; i < NUMBLOCKS; i++)
+	 {
+		x = snapshot->curx + orient->block[i].x;
+		y = snapshot->cury + orient->block[i].y;
+		if (x < 1 || x > NUMCOLS - 3 || y < 0 || y > NUMROWS - 3) return FALSE;
+	 }
+   for (y = 0; y < NUMROWS - 2; y++)
+	 if ((snapshot->row[y] & WALLROW) != WALLROW || (snapshot->row[y] & ~FULLROW)) return FALSE;
+   /* same as measure() */
+   for (x = 1; x < NUMCOLS - 2; x++)
+	 {
+		for (y = 0; y < NUMROWS - 2 && !(snapshot->row[y] & (1 << x)); y++) ;
+		if (snapshot->height[x - 1] != NUMROWS - 2 - y) return FALSE;
+	 }
+   return TRUE;
+}
+
+/*
+ * Restore the state of the specified tetris engine from a snapshot. The
+ * engine must have been initialized with engine_init(), since the score
+ * function, its user data and the colors of the blocks are kept (colors
+ * aren't part of the snapshot, so blocks that weren't on the board before
+ * are made white). Returns OK, or ERR (leaving the engine as it was) if the
+ * snapshot fails engine_check()
+ */
+int engine_restore(engine_t *engine, const snapshot_t *snapshot)
+{
+   int x,y;
+   if (!engine_check(snapshot)) return ERR;
+   engine->seed = snapshot->seed;
+   engine->score = snapshot->score;
+   engine->status = snapshot->status;
+   /* only the rows that changed need their colors fixed */
+   for (y = 0; y < NUMROWS - 2; y++)
+	 if (engine->board.row[y] != snapshot->row[y])
+	   {
+		  engine->board.row[y] = snapshot->row[y];
+		  for (x = 1; x < NUMCOLS - 2; x++)
+			if (!(snapshot->row[y] & (1 << x))) engine->board.color[y][x] = COLOR_BLACK;
+			else if (engine->board.color[y][x] == COLOR_BLACK) engine->board.color[y][x] = COLOR_WHITE;
+	   }
+   memcpy(engine->board.height + 1, snapshot->height, sizeof(snapshot->height));
+   engine->curx = snapshot->curx;
+   engine->cury = snapshot->cury;
+   engine->curshape = snapshot->curshape;
+   engine->nextshape = snapshot->nextshape;
+   engine->curorient = snapshot->curorient;
+   return OK;
+}
+
+/*
+ * Get a view of the specified tetris engine's board for drawing,
+ * i.e. the locked blocks with the current shape on top of them
+ */
+void engine_view(const engine_t *engine, board_t *view)
+{
+   memcpy(view, &engine->board, sizeof(board_t));
+   drawshape(view, SHAPES[engine->curshape].color, &SHAPES[engine->curshape].orient[engine->curorient], engine->curx, engine->cury);
+}
+
+/*
+ * Get the height of the locked blocks in each column of the specified
+ * tetris engine's board (0 = empty column, the walls are as high as the board)
+ */
+const unsigned char *engine_heights(const engine_t *engine)
+{
+   return engine->board.height;
+}
+
+/*
+ * Get the profile counters of the calling thread, for the i'th profiled
+ * function (see profile_t). Returns the name of the function, or NULL if i
+ * is out of range or the engine wasn't built with -DENGINE_PROFILE (make
+ * PROFILE=1). The cycles include the functions it calls.
+ */
+const char *engine_profile(int i, uint64_t *calls, uint64_t *cycles)
+{
+#ifdef ENGINE_PROFILE
+   if (i < 0 || i >= NUMPROFILES) return NULL;
+   *calls = profile[i].calls;
+   *cycles = profile[i].cycles;
+   return profilename[i];
+#else
+   return NULL;
+#endif
+}
@@ -9,7 +9,10 @@
  * See the LICENSE file in the project root for full license text.
  */
 
+#include <stdint.h>			/* uint64_t */
+
 #include "typedefs.h"		/* bool */
+#include "colors.h"		/* COLOR_* (colors of the shapes) */
 
 /*
  * Macros
@@ -21,6 +24,9 @@
 /* Number of blocks in each shape */
 #define NUMBLOCKS	4
 
+/* Maximum number of orientations of a shape */
+#define NUMORIENTS	4
+
 /* Number of rows and columns in board */
 #define NUMROWS	23
 #define NUMCOLS	13
@@ -28,23 +34,42 @@
 /* Wall id - Arbitrary, but shouldn't have the same value as one of the colors */
 #define WALL 16
 
+/* Row bitmasks: the walls (left column and two right columns) and a completely filled row */
+#define WALLROW	((1 << 0) | (1 << (NUMCOLS - 2)) | (1 << (NUMCOLS - 1)))
+#define FULLROW	((1 << NUMCOLS) - 1)
+
 /*
  * Type definitions
  */
 
-typedef int board_t[NUMCOLS][NUMROWS];
+/* One bit per column, bit x is set if cell x of the row is occupied */
+typedef unsigned short row_t;
+
+typedef struct
+{
+   row_t row[NUMROWS];						/* occupied cells (walls included) */
+   unsigned char color[NUMROWS][NUMCOLS];	/* color of each cell (only read by the renderer) */
+   unsigned char height[NUMCOLS];			/* height of the blocks in each column (0 = empty) */
+} board_t;
 
 typedef struct
 {
    int x,y;
 } block_t;
 
+typedef struct
+{
+   block_t block[NUMBLOCKS];	/* offsets of the blocks from the centre of the shape */
+   int left,right,top,bottom;	/* bounding box of the blocks */
+   row_t mask[NUMBLOCKS];		/* blocks in each row from top to bottom (bit x + 1 = offset x) */
+   int lowest[NUMBLOCKS];		/* lowest block in each column from left to right */
+} orient_t;
+
 typedef struct
 {
    int color;
-   int type;
-   bool flipped;
-   block_t block[NUMBLOCKS];
+   int orients;					/* number of distinct orientations */
+   orient_t orient[NUMORIENTS];	/* orientations in the order the shape rotates through them */
 } shape_t,shapes_t[NUMSHAPES];
 
 typedef struct
@@ -60,14 +85,54 @@ typedef struct engine_struct
 {
    int curx,cury;									/* coordinates of current piece */
    int curshape,nextshape;							/* current & next shapes */
+   int curorient;									/* orientation of current shape */
    int score;										/* score */
-   shapes_t shapes;									/* shapes */
-   board_t board;									/* board */
+   board_t board;									/* locked blocks (without the current shape) */
    status_t status;									/* current status of shapes */
-   void (*score_function)(struct engine_struct *);	/* score function */
+   uint64_t seed;									/* random number generator state */
+   void (*score_function)(struct engine_struct *,void *);	/* score function */
+   void *userdata;									/* passed to the score function */
 } engine_t;
 
-typedef enum { ACTION_LEFT, ACTION_ROTATE, ACTION_RIGHT, ACTION_DROP } action_t;
+/* Compact copy of the state of an engine (less than 128 bytes) */
+typedef struct
+{
+   uint64_t seed;									/* random number generator state */
+   int score;										/* score */
+   status_t status;									/* current status of shapes */
+   row_t row[NUMROWS - 2];							/* locked blocks above the floor */
+   unsigned char height[NUMCOLS - 3];				/* height of the blocks in each column */
+   signed char curx,cury;							/* coordinates of current piece */
+   signed char curshape,nextshape,curorient;		/* current & next shapes, orientation */
+} snapshot_t;
+
+/* ACTION_DOWN moves the shape one row down like gravity, but never locks it */
+typedef enum { ACTION_LEFT, ACTION_ROTATE, ACTION_RIGHT, ACTION_DROP, ACTION_DOWN } action_t;
+
+/* Functions counted by engine_profile() */
+typedef enum
+{
+   PROFILE_ALLOWED, PROFILE_SHAPE_LEFT, PROFILE_SHAPE_RIGHT, PROFILE_SHAPE_ROTATE, PROFILE_SHAPE_DOWN,
+   PROFILE_SHAPE_BOTTOM, PROFILE_SHAPE_DROP, PROFILE_DROPLINES, PROFILE_RAND_VALUE, NUMPROFILES
+} profile_t;
+
+/* Number of positions a shape can be in (column, row and orientation) */
+#define NUMSTATES (NUMCOLS * NUMROWS * NUMORIENTS)
+
+typedef struct
+{
+   int x,y;											/* coordinates of the shape at rest */
+   int orient;										/* orientation of the shape at rest */
+   int moves;										/* number of actions needed to get there */
+} placement_t;
+
+typedef struct
+{
+   int count;										/* number of placements */
+   placement_t placement[NUMSTATES];				/* placements, nearest first */
+   short parent[NUMSTATES];							/* previous state on the shortest path to each state */
+   unsigned char action[NUMSTATES];					/* action that leads to each state from its parent */
+} placements_t;
 
 /*
  * Global variables
@@ -80,9 +145,11 @@ extern const shapes_t SHAPES;
  */
 
 /*
- * Initialize specified tetris engine
+ * Initialize specified tetris engine. The sequence of shapes is determined
+ * by the seed, so the same seed and moves always give the same game. The
+ * score function is called with userdata whenever a shape is locked.
  */
-void engine_init(engine_t *engine, void (*score_function)(engine_t *));
+void engine_init(engine_t *engine, void (*score_function)(engine_t *,void *), void *userdata, uint64_t seed);
 
 /*
  * Perform the given action on the specified tetris engine
@@ -99,4 +166,62 @@ void engine_move(engine_t *engine, action_t action);
  */
 int engine_evaluate(engine_t *engine);
 
+/*
+ * Find every position where the current shape of the specified tetris engine
+ * can come to rest, using the same moves and collision rules as
+ * engine_move() and engine_evaluate(). The engine is not modified. Returns
+ * the number of placements (0 if the game is over).
+ */
+int engine_enumerate_placements(const engine_t *engine, placements_t *placements);
+
+/*
+ * Get the shortest sequence of actions that takes the current shape from
+ * where it is to the given placement. The path must have room for
+ * placement->moves actions. Returns the number of actions.
+ */
+int engine_placement_path(const placements_t *placements, const placement_t *placement, action_t *path);
+
+/*
+ * Save the state of the specified tetris engine in a snapshot
+ */
+void engine_snapshot(const engine_t *engine, snapshot_t *snapshot);
+
+/*
+ * Check that a snapshot is one engine_snapshot() could have made: the
+ * shapes and orientation exist, every block of the current shape is on the
+ * board, the rows have their walls and the heights agree with the rows.
+ * Returns TRUE if it is
+ */
+bool engine_check(const snapshot_t *snapshot);
+
+/*
+ * Restore the state of the specified tetris engine from a snapshot. The
+ * engine must have been initialized with engine_init(), since the score
+ * function, its user data and the colors of the blocks are kept (colors
+ * aren't part of the snapshot, so blocks that weren't on the board before
+ * are made white). Returns OK, or ERR (leaving the engine as it was) if the
+ * snapshot fails engine_check()
+ */
+int engine_restore(engine_t *engine, const snapshot_t *snapshot);
+
+/*
+ * Get a view of the specified tetris engine's board for drawing,
+ * i.e. the locked blocks with the current shape on top of them
+ */
+void engine_view(const engine_t *engine, board_t *view);
+
+/*
+ * Get the height of the locked blocks in each column of the specified
+ * tetris engine's board (0 = empty column, the walls are as high as the board)
+ */
+const unsigned char *engine_heights(const engine_t *engine);
+
+/*
+ * Get the profile counters of the calling thread, for the i'th profiled
+ * function (see profile_t). Returns the name of the function, or NULL if i
+ * is out of range or the engine wasn't built with -DENGINE_PROFILE (make
+ * PROFILE=1). The cycles include the functions it calls.
+ */
+const char *engine_profile(int i, uint64_t *calls, uint64_t *cycles);
+
 #endif	/* #ifndef ENGINE_H */
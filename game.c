@@ -0,0 +1,148 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <string.h>		/* memset(), memcpy() */
+#include <limits.h>		/* INT_MAX */
+
+#include "typedefs.h"
+#include "game.h"
+
+/* A keyframe is recorded every this many shapes (see replay.h) */
+#define KEYFRAMES	100
+
+/* This function is responsible for increasing the score appropriately whenever
+ * a block collides at the bottom of the screen (or the top of the heap */
+static void score_function(engine_t *engine, void *userdata)
+{
+   const game_t *game = userdata;
+   int score = SCOREVAL(game->level * (engine->status.dropcount + 1));
+
+   if (game->shownext) score /= 2;
+   if (game->dottedlines) score /= 2;
+
+   engine->score += score;
+}
+
+/* Start a new game with the level and options already in the session */
+void game_init(game_t *game, uint64_t seed)
+{
+   engine_init(&game->engine, score_function, game, seed);
+   memset(game->shapecount, 0, sizeof(game->shapecount));
+   game->shapecount[game->engine.curshape]++;
+   game->ticks = 0;
+   game->locked = 0;
+   game->recordfailed = FALSE;
+}
+
+/* Stop recording if the replay couldn't be written (the game goes on) */
+static void recorded(game_t *game, int result)
+{
+   if (result == OK) return;
+   replay_close(game->replay);
+   game->replay = NULL;
+   game->recordfailed = TRUE;
+}
+
+/* Do what the player asked for (REPLAY_LEFT to REPLAY_LEVELUP). Returns FALSE if it can't be done (already at the last level) */
+bool game_event(game_t *game, int event)
+{
+   bool done = TRUE;
+   switch (event)
+	 {
+	  case REPLAY_LEFT:
+	  case REPLAY_ROTATE:
+	  case REPLAY_RIGHT:
+	  case REPLAY_DROP:
+	  case REPLAY_DOWN:
+		engine_move(&game->engine, event);
+		break;
+		/* show next piece */
+	  case REPLAY_SHOWNEXT:
+		game->shownext = TRUE;
+		break;
+		/* toggle dotted lines */
+	  case REPLAY_DOTTED:
+		game->dottedlines = !game->dottedlines;
+		break;
+		/* next level */
+	  case REPLAY_LEVELUP:
+		if (game->level < MAXLEVEL) game->level++;
+		else done = FALSE;
+		break;
+	 }
+   if (game->replay != NULL) recorded(game, replay_write(game->replay, game->ticks, event));
+   return done;
+}
+
+/* Move the shape down a row. Returns the same as engine_evaluate() */
+int game_gravity(game_t *game)
+{
+   keyframe_t keyframe;
+   int status;
+   game->ticks++;
+   status = engine_evaluate(&game->engine);
+   /* a shape was locked (and the next one released, unless the game is over) */
+   if (status <= 0 && (game->level < MAXLEVEL) && ((game->engine.status.droppedlines / 10) > game->level)) game->level++;
+   if (status == 0)
+	 {
+		game->shapecount[game->engine.curshape]++;
+		if (++game->locked % KEYFRAMES == 0 && game->replay != NULL)
+		  {
+			 game_keyframe(game, &keyframe);
+			 recorded(game, replay_keyframe(game->replay, &keyframe));
+		  }
+	 }
+   return status;
+}
+
+/* Options of the game as REPLAY_FLAG_* */
+int game_flags(const game_t *game)
+{
+   return (game->shownext ? REPLAY_FLAG_SHOWNEXT : 0) | (game->dottedlines ? REPLAY_FLAG_DOTTED : 0);
+}
+
+/* Number of shapes released so far */
+int game_shapes(const game_t *game)
+{
+   int i,sum = 0;
+   for (i = 0; i < NUMSHAPES; i++) sum += game->shapecount[i];
+   return sum;
+}
+
+/* Get the state of the game for a replay */
+void game_keyframe(const game_t *game, keyframe_t *keyframe)
+{
+   keyframe->tick = game->ticks;
+   keyframe->level = game->level;
+   keyframe->flags = game_flags(game);
+   memcpy(keyframe->shapecount, game->shapecount, sizeof(game->shapecount));
+   engine_snapshot(&game->engine, &keyframe->snapshot);
+}
+
+/* Carry on from the state in a keyframe (the game must have been started with the seed of the replay). Returns OK, or ERR (leaving the game as it was) if the keyframe isn't a state the game can be in */
+int game_restore(game_t *game, const keyframe_t *keyframe)
+{
+   int64_t shapes = 0;
+   int i;
+   /* the current shape has been counted, so there is at least one (the players divide by game_shapes()) */
+   for (i = 0; i < NUMSHAPES; i++)
+	 {
+		if (keyframe->shapecount[i] < 0) return ERR;
+		shapes += keyframe->shapecount[i];
+	 }
+   if (shapes < 1 || shapes > INT_MAX || keyframe->snapshot.curshape < 0 || keyframe->snapshot.curshape >= NUMSHAPES || keyframe->shapecount[keyframe->snapshot.curshape] < 1) return ERR;
+   if (keyframe->level < MINLEVEL || keyframe->level > MAXLEVEL || engine_restore(&game->engine, &keyframe->snapshot) != OK) return ERR;
+   game->ticks = keyframe->tick;
+   game->level = keyframe->level;
+   game->shownext = (keyframe->flags & REPLAY_FLAG_SHOWNEXT) != 0;
+   game->dottedlines = (keyframe->flags & REPLAY_FLAG_DOTTED) != 0;
+   memcpy(game->shapecount, keyframe->shapecount, sizeof(game->shapecount));
+   /* every shape released so far was locked, except the current one */
+   game->locked = game_shapes(game) - 1;
+   return OK;
+}
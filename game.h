@@ -0,0 +1,76 @@
+#ifndef GAME_H
+#define GAME_H
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <stdint.h>			/* uint64_t */
+
+#include "typedefs.h"		/* bool */
+#include "engine.h"
+#include "replay.h"			/* REPLAY_*, replay_t, keyframe_t */
+
+/*
+ * A game session: the engine and the rules of tint around it (levels,
+ * scoring, the options the player can change and the statistics). All of
+ * the state of a game is in here, so one process can run any number of
+ * games at the same time.
+ */
+
+/* Number of levels in the game */
+#define MINLEVEL	1
+#define MAXLEVEL	9
+
+/* The score is multiplied by this to avoid losing precision */
+#define SCOREFACTOR 2
+
+/* This calculates the stored score value */
+#define SCOREVAL(x) (SCOREFACTOR * (x))
+
+/* This calculates the real (displayed) value of the score */
+#define GETSCORE(score) ((score) / SCOREFACTOR)
+
+/* This calculates the time (in microseconds) allowed to move a shape, before it is moved a row down */
+#define DELAY(level) (1000000 / ((level) + 2))
+
+typedef struct
+{
+   engine_t engine;
+   int level;						/* current level */
+   bool shownext;					/* draw the next shape (halves the score) */
+   bool dottedlines;				/* draw dotted lines (halves the score) */
+   int shapecount[NUMSHAPES];		/* number of each shape released so far */
+   uint64_t ticks;					/* gravity ticks so far */
+   int locked;						/* shapes locked so far */
+   replay_t *replay;				/* where the game is recorded (NULL if it isn't) */
+   bool recordfailed;				/* the replay couldn't be written, so recording stopped */
+   const char *scorefile;			/* where the player's high scores are kept (NULL if they aren't) */
+} game_t;
+
+/* Start a new game with the level and options already in the session */
+void game_init(game_t *game, uint64_t seed);
+
+/* Do what the player asked for (REPLAY_LEFT to REPLAY_LEVELUP). Returns FALSE if it can't be done (already at the last level) */
+bool game_event(game_t *game, int event);
+
+/* Move the shape down a row. Returns the same as engine_evaluate() */
+int game_gravity(game_t *game);
+
+/* Options of the game as REPLAY_FLAG_* */
+int game_flags(const game_t *game);
+
+/* Number of shapes released so far */
+int game_shapes(const game_t *game);
+
+/* Get the state of the game for a replay */
+void game_keyframe(const game_t *game, keyframe_t *keyframe);
+
+/* Carry on from the state in a keyframe (the game must have been started with the seed of the replay). Returns OK, or ERR (leaving the game as it was) if the keyframe isn't a state the game can be in */
+int game_restore(game_t *game, const keyframe_t *keyframe);
+
+#endif	/* #ifndef GAME_H */
@@ -1,4 +1,3 @@
-
 /*
  * TINT - TINT Is Not Tetris
  * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
@@ -8,40 +7,84 @@
  */
 
 #include <stdarg.h>		/* va_list(), va_start(), va_end() */
-#include <sys/time.h>	/* gettimeofday() */
-#include <unistd.h>		/* gettimeofday() */
-
-#include <curses.h>
+#include <stdio.h>		/* vsnprintf() */
+#include <string.h>		/* strcmp() */
+#include <stdint.h>		/* int64_t, uint64_t */
+#include <time.h>		/* clock_gettime() */
+#include <unistd.h>		/* read(), close() */
+#include <poll.h>		/* poll() */
+#include <signal.h>		/* sigprocmask() */
+#include <sys/timerfd.h>	/* timerfd_create(), timerfd_settime() */
+#include <sys/signalfd.h>	/* signalfd() */
 
+#include "typedefs.h"
 #include "io.h"
+#include "io_backend.h"
+
+/* Longest string out_printf() can write */
+#define MAXPRINTF	256
+
+/* Available backends, the first one is the default */
+static const io_backend_t *backends[] = { &io_curses, &io_ansi, &io_null, NULL };
+
+/* Backend in use */
+static const io_backend_t *backend = &io_curses;
+
+/* Number of out_* calls made and bytes written to the terminal so far */
+static unsigned long out_calls,out_bytes;
 
-/* Number of colors defined in io.h */
-#define NUM_COLORS	8
+/* Set by out_measure() */
+bool io_measure = FALSE;
 
-/* Number of attributes defined in io.h */
-#define NUM_ATTRS	9
+/* Time between gravity ticks (in microseconds) */
+static int64_t in_period;
 
-/* Cursor definitions */
-#define CURSOR_INVISIBLE	0
-#define CURSOR_NORMAL		1
+/* Time of the next gravity tick (in microseconds on the monotonic clock) */
+static int64_t in_deadline;
 
-/* Maps color definitions onto their real definitions */
-static int color_map[NUM_COLORS];
+/* The clock for backends that don't really wait (see io_backend_t) */
+static int64_t in_virtual;
 
-/* Maps attribute definitions onto their real definitions */
-static int attr_map[NUM_ATTRS];
+/* Gravity timer and SIGWINCH (-1 if the backend isn't realtime) */
+static int in_timerfd = -1, in_signalfd = -1;
 
-/* Current attribute used on screen */
-static int out_attr;
+/* Signals we read from in_signalfd instead of handling them */
+static sigset_t in_signals;
 
-/* Current color used on screen */
-static int out_color;
+/* Set once the keyboard has gone away (we stop polling it) */
+static bool in_hangup;
 
-/* This is the timeout in microseconds */
-static int in_timetotal;
+/* A key read ahead by in_wait() (ERR if none) */
+static int in_pending = ERR;
 
-/* This is the amount of time left to before a timeout occurs (in microseconds) */
-static int in_timeleft;
+/* The clock at which backends that don't really wait may give us the next key */
+static int64_t in_keytime;
+
+/*
+ * Backends
+ */
+
+/* Choose the backend to use (must be called before io_init()). Returns OK or ERR if there is no such backend */
+int io_select(const char *name)
+{
+   int i;
+   for (i = 0; backends[i] != NULL; i++)
+	 if (strcmp(backends[i]->name, name) == 0)
+	   {
+		  backend = backends[i];
+		  return OK;
+	   }
+   return ERR;
+}
+
+/* Get the name and description of backend i (FALSE if there are fewer backends) */
+int io_backend(int i, const char **name, const char **description)
+{
+   if (i < 0 || i >= sizeof(backends) / sizeof(backends[0]) - 1) return FALSE;
+   *name = backends[i]->name;
+   *description = backends[i]->description;
+   return TRUE;
+}
 
 /*
  * Init & Close
@@ -50,40 +93,24 @@ static int in_timeleft;
 /* Initialize screen */
 void io_init()
 {
-   initscr();
-   start_color();
-   curs_set(CURSOR_INVISIBLE);
-   out_attr = A_NORMAL;
-   out_color = COLOR_WHITE;
-   noecho();
-   /* Map colors */
-   color_map[COLOR_BLACK] = COLOR_BLACK;
-   color_map[COLOR_RED] = COLOR_RED;
-   color_map[COLOR_GREEN] = COLOR_GREEN;
-   color_map[COLOR_YELLOW] = COLOR_YELLOW;
-   color_map[COLOR_BLUE] = COLOR_BLUE;
-   color_map[COLOR_MAGENTA] = COLOR_MAGENTA;
-   color_map[COLOR_CYAN] = COLOR_CYAN;
-   color_map[COLOR_WHITE] = COLOR_WHITE;
-   /* Map attributes */
-   attr_map[ATTR_OFF] = A_NORMAL;
-   attr_map[ATTR_BOLD] = A_BOLD;
-   attr_map[ATTR_DIM] = A_DIM;
-   attr_map[ATTR_UNDERLINE] = A_UNDERLINE;
-   attr_map[ATTR_BLINK] = A_BLINK;
-   attr_map[ATTR_REVERSE] = A_REVERSE;
-   attr_map[ATTR_INVISIBLE] = A_INVIS;
+   backend->init();
+   if (!backend->realtime) return;
+   in_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   sigemptyset(&in_signals);
+   sigaddset(&in_signals, SIGWINCH);
+   sigprocmask(SIG_BLOCK, &in_signals, NULL);
+   in_signalfd = signalfd(-1, &in_signals, SFD_NONBLOCK | SFD_CLOEXEC);
 }
 
 /* Restore original screen state */
 void io_close()
 {
-   echo();
-   attrset(A_NORMAL);
-   clear();
-   curs_set(CURSOR_NORMAL);
-   refresh();
-   endwin();
+   backend->close();
+   if (!backend->realtime) return;
+   close(in_timerfd);
+   close(in_signalfd);
+   in_timerfd = in_signalfd = -1;
+   sigprocmask(SIG_UNBLOCK, &in_signals, NULL);
 }
 
 /*
@@ -93,104 +120,200 @@ void io_close()
 /* Set color attributes */
 void out_setattr(int attr)
 {
-   out_attr = attr_map[attr];
+   out_calls++;
+   backend->setattr(attr);
 }
 
 /* Set color */
 void out_setcolor(int fg, int bg)
 {
-   out_color = (color_map[bg] << 3) + color_map[fg];
-   init_pair(out_color, color_map[fg], color_map[bg]);
-   attrset(COLOR_PAIR(out_color) | out_attr);
+   out_calls++;
+   backend->setcolor(fg, bg);
 }
 
 /* Move cursor to position (x,y) on the screen. Upper corner of screen is (0,0) */
 void out_gotoxy(int x, int y)
 {
-   move(y, x);
+   out_calls++;
+   backend->gotoxy(x, y);
 }
 
 /* Put a character on the screen */
 void out_putch(char ch)
 {
-   addch(ch);
+   out_calls++;
+   backend->putch(ch);
 }
 
 /* Put a string on the screen */
 void out_printf(char *format, ...)
 {
+   char str[MAXPRINTF];
    va_list ap;
    va_start(ap, format);
-   vw_printw(stdscr, format, ap);
+   vsnprintf(str, sizeof(str), format, ap);
    va_end(ap);
+   out_calls++;
+   backend->puts(str);
 }
 
 /* Refresh screen */
 void out_refresh()
 {
-   refresh();
+   out_calls++;
+   backend->refresh();
+}
+
+/* Count the bytes written to the terminal (must be called before io_init()) */
+void out_measure()
+{
+   io_measure = TRUE;
+}
+
+/* Get the number of out_* calls made and bytes written to the terminal so far */
+void out_stats(unsigned long *calls, unsigned long *bytes)
+{
+   *calls = out_calls;
+   *bytes = out_bytes;
+}
+
+/* Called by the backends with the number of bytes they wrote to the terminal */
+void io_written(int n)
+{
+   out_bytes += n;
 }
 
 /* Get the screen width */
 int out_width()
 {
-   return COLS;
+   return backend->width();
 }
 
 /* Get the screen height */
 int out_height()
 {
-   return LINES;
+   return backend->height();
 }
 
 /* Beep */
 void out_beep()
 {
-   beep();
+   out_calls++;
+   backend->beep();
 }
 
 /*
  * Input
  */
 
-/* Read a character. Please note that you MUST call in_timeout() before in_getch() */
-int in_getch()
+/* Current time in microseconds. Only the differences mean anything */
+int64_t io_clock()
 {
-   struct timeval starttv,endtv;
-   int ch;
-   timeout(in_timeleft / 1000);
-   gettimeofday(&starttv, NULL);
-   ch = getch();
-   gettimeofday(&endtv, NULL);
-   /* Timeout? */
-   if (ch == ERR)
-	 in_timeleft = in_timetotal;
-   /* No? Then calculate time left */
-   else
+   struct timespec ts;
+   if (!backend->realtime) return in_virtual;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Wait at most timeout microseconds (forever if negative) until something
+ * happens and return what it was (IN_KEY, IN_TICK and/or IN_RESIZE), or 0
+ * if the time ran out or a signal arrived. Please note that you MUST call
+ * in_timeout() first.
+ *
+ * Ticks come from a timer with absolute deadlines, one period apart, so
+ * the time spent reading keys and drawing never pushes gravity back. If
+ * we fall behind (we were suspended?) the missed ticks are dropped rather
+ * than delivered in a burst.
+ */
+int in_wait(int timeout)
+{
+   struct pollfd pfd[3];
+   struct signalfd_siginfo si;
+   uint64_t expired;
+   int n,events = 0;
+   if (!backend->realtime)
 	 {
-		endtv.tv_sec -= starttv.tv_sec;
-		endtv.tv_usec -= starttv.tv_usec;
-		if (endtv.tv_usec < 0)
+		/* one key per gravity tick (any number while gravity is stopped), then whichever comes first (time only passes when we say so) */
+		if (in_pending == ERR && (in_period == 0 || in_virtual >= in_keytime) && (in_pending = backend->getch()) != ERR)
+		  in_keytime = in_deadline;
+		if (in_pending != ERR) return IN_KEY;
+		if (timeout >= 0 && (in_period == 0 || in_virtual + timeout < in_deadline))
 		  {
-			 endtv.tv_usec += 1000000;
-			 endtv.tv_sec--;
+			 in_virtual += timeout;
+			 return 0;
 		  }
-		in_timeleft -= endtv.tv_usec;
-		if (in_timeleft <= 0) in_timeleft = in_timetotal;
+		in_virtual = in_deadline;
+		in_deadline += in_period;
+		return IN_TICK;
+	 }
+   pfd[0].fd = in_hangup ? -1 : STDIN_FILENO;
+   pfd[1].fd = in_timerfd;
+   pfd[2].fd = in_signalfd;
+   pfd[0].events = pfd[1].events = pfd[2].events = POLLIN;
+   /* poll() waits in whole milliseconds, round up so that we don't wake up too early */
+   n = poll(pfd, 3, timeout < 0 ? -1 : (timeout + 999) / 1000);
+   /* timed out or interrupted by a signal */
+   if (n <= 0) return 0;
+   if (pfd[0].revents & POLLIN) events |= IN_KEY;
+   else if (pfd[0].revents) in_hangup = TRUE;
+   if ((pfd[1].revents & POLLIN) && read(in_timerfd, &expired, sizeof(expired)) == sizeof(expired)) events |= IN_TICK;
+   if ((pfd[2].revents & POLLIN) && read(in_signalfd, &si, sizeof(si)) == sizeof(si))
+	 {
+		backend->resize();
+		events |= IN_RESIZE;
 	 }
+   return events;
+}
+
+/* Read a key that is already waiting (ERR if there is none). Never waits for one */
+int in_getch()
+{
+   int ch = in_pending;
+   in_pending = ERR;
+   /* backends that don't really wait only give keys to in_wait() (see above) */
+   if (ch == ERR && backend->realtime) return backend->getch();
    return ch;
 }
 
-/* Set keyboard timeout in microseconds */
+/* Time of the next gravity tick */
+static int64_t in_next()
+{
+   struct itimerspec its;
+   if (!backend->realtime) return in_deadline;
+   timerfd_gettime(in_timerfd, &its);
+   return io_clock() + (int64_t) its.it_value.tv_sec * 1000000 + its.it_value.tv_nsec / 1000;
+}
+
+/* Convert microseconds to a timespec */
+static struct timespec in_timespec(int64_t usec)
+{
+   struct timespec ts;
+   ts.tv_sec = usec / 1000000;
+   ts.tv_nsec = usec % 1000000 * 1000;
+   return ts;
+}
+
+/*
+ * Set the time between gravity ticks in microseconds. The next tick is
+ * counted from the last one, or from now if gravity was stopped. Zero
+ * stops gravity (e.g. while the game is paused).
+ */
 void in_timeout(int delay)
 {
-   /* ncurses timeout() function works with milliseconds, not microseconds */
-   in_timetotal = in_timeleft = delay;
+   struct itimerspec its;
+   in_deadline = in_period ? in_next() - in_period + delay : io_clock() + delay;
+   in_period = delay;
+   if (!backend->realtime) return;
+   /* a deadline that has already passed fires straight away */
+   its.it_value = in_timespec(delay ? in_deadline : 0);
+   its.it_interval = in_timespec(delay);
+   timerfd_settime(in_timerfd, TFD_TIMER_ABSTIME, &its, NULL);
 }
 
 /* Empty keyboard buffer */
 void in_flush()
 {
-   flushinp();
+   in_pending = ERR;
+   backend->flush();
 }
-
@@ -9,18 +9,9 @@
  * See the LICENSE file in the project root for full license text.
  */
 
-/*
- * Colors
- */
+#include <stdint.h>		/* int64_t */
 
-#define COLOR_BLACK     0                        /* Black */
-#define COLOR_RED       1                        /* Red */
-#define COLOR_GREEN     2                        /* Green */
-#define COLOR_YELLOW    3                        /* Yellow */
-#define COLOR_BLUE      4                        /* Blue */
-#define COLOR_MAGENTA   5                        /* Magenta */
-#define COLOR_CYAN      6                        /* Cyan */
-#define COLOR_WHITE     7                        /* White */
+#include "colors.h"		/* COLOR_* */
 
 /*
  * Attributes
@@ -34,6 +25,16 @@
 #define ATTR_REVERSE    7                        /* Reverse Video On */
 #define ATTR_INVISIBLE  8                        /* Concealed On */
 
+/*
+ * Backends
+ */
+
+/* Choose the backend to use (must be called before io_init()). Returns OK or ERR if there is no such backend */
+int io_select(const char *name);
+
+/* Get the name and description of backend i (FALSE if there are fewer backends) */
+int io_backend(int i, const char **name, const char **description);
+
 /*
  * Init & Close
  */
@@ -66,6 +67,12 @@ void out_printf(char *format, ...);
 /* Refresh screen */
 void out_refresh();
 
+/* Count the bytes written to the terminal (must be called before io_init()) */
+void out_measure();
+
+/* Get the number of out_* calls made and bytes written to the terminal so far */
+void out_stats(unsigned long *calls, unsigned long *bytes);
+
 /* Get the screen width */
 int out_width();
 
@@ -79,10 +86,21 @@ void out_beep();
  * Input
  */
 
-/* Read a character */
+/* Current time in microseconds on a clock that never jumps (only the differences mean anything) */
+int64_t io_clock();
+
+/* Events returned by in_wait() */
+#define IN_KEY		1	/* There are keys to read with in_getch() */
+#define IN_TICK		2	/* Time for gravity */
+#define IN_RESIZE	4	/* The screen changed size (and was cleared) */
+
+/* Wait at most timeout microseconds (forever if negative) until something happens and return what it was (IN_* flags, 0 if the time ran out) */
+int in_wait(int timeout);
+
+/* Read a key that is already waiting (ERR if there is none). Never waits for one */
 int in_getch();
 
-/* Set keyboard timeout in microseconds */
+/* Set the time between gravity ticks in microseconds (zero stops gravity). The next tick is counted from the last one */
 void in_timeout(int delay);
 
 /* Empty keyboard buffer */
@@ -0,0 +1,242 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Raw VT100/ANSI backend. Everything drawn is collected in a frame buffer
+ * and written to the terminal with a single write() when the screen is
+ * refreshed. Colors & cursor movements are only sent when they change.
+ */
+
+#include <stdio.h>		/* snprintf() */
+#include <string.h>		/* strlen(), memcpy(), memset() */
+#include <unistd.h>		/* read(), write() */
+#include <signal.h>		/* sigaction(), raise() */
+#include <poll.h>		/* poll() */
+#include <termios.h>	/* tcgetattr(), tcsetattr(), tcflush() */
+#include <sys/ioctl.h>	/* ioctl(), TIOCGWINSZ */
+
+#include "typedefs.h"
+#include "io.h"
+#include "io_backend.h"
+
+/* Size of the frame buffer */
+#define BUFSIZE	16384
+
+/* Size of the screen if the terminal doesn't know */
+#define DEFAULT_WIDTH	80
+#define DEFAULT_HEIGHT	24
+
+/* Frame buffer */
+static char buf[BUFSIZE];
+static int buflen;
+
+/* Terminal settings before io_init() */
+static struct termios oldtermios;
+
+/* Signals that would leave the terminal as we set it up & what they did before io_init() */
+static const int signals[] = { SIGINT, SIGTERM, SIGHUP };
+#define NUMSIGNALS	(sizeof(signals) / sizeof(signals[0]))
+static struct sigaction oldactions[NUMSIGNALS];
+
+/* Leave the alternate screen with the cursor visible again */
+static const char restorescreen[] = "\033[0m\033[2J\033[?25h\033[?1049l";
+
+/* Current attribute used on screen */
+static int out_attr;
+
+/* Attribute & colors last sent to the terminal (-1 = unknown) */
+static int cur_attr,cur_fg,cur_bg;
+
+/* Where the terminal's cursor is (-1 = unknown) */
+static int cur_x,cur_y;
+
+/* Write the frame buffer to the terminal */
+static void flushbuf()
+{
+   int i,n;
+   for (i = 0; i < buflen; i += n)
+	 {
+		if ((n = write(STDOUT_FILENO, buf + i, buflen - i)) <= 0) break;
+		io_written(n);
+	 }
+   buflen = 0;
+}
+
+/* Add a string to the frame buffer */
+static void append(const char *str, int len)
+{
+   if (buflen + len > BUFSIZE) flushbuf();
+   memcpy(buf + buflen, str, len);
+   buflen += len;
+}
+
+/*
+ * Init & Close
+ */
+
+/* Killed (^C, kill or the terminal hung up): put the terminal back the way it was (only async-signal-safe calls), then die the way we would have */
+static void killed(int sig)
+{
+   ssize_t n = write(STDOUT_FILENO, restorescreen, sizeof(restorescreen) - 1);
+   (void) n;
+   tcsetattr(STDIN_FILENO, TCSANOW, &oldtermios);
+   signal(sig, SIG_DFL);
+   raise(sig);
+}
+
+/* Initialize screen */
+static void ansi_init()
+{
+   struct termios termios;
+   struct sigaction sa;
+   int i;
+   if (tcgetattr(STDIN_FILENO, &oldtermios) == 0)
+	 {
+		termios = oldtermios;
+		termios.c_lflag &= ~(ICANON | ECHO);
+		termios.c_cc[VMIN] = 1;
+		termios.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &termios);
+	 }
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = killed;
+   sigemptyset(&sa.sa_mask);
+   for (i = 0; i < NUMSIGNALS; i++)
+	 {
+		sigaction(signals[i], NULL, &oldactions[i]);
+		/* leave alone the ones we were told to ignore (nohup) */
+		if (oldactions[i].sa_handler != SIG_IGN) sigaction(signals[i], &sa, NULL);
+	 }
+   out_attr = ATTR_OFF;
+   cur_attr = cur_fg = cur_bg = cur_x = cur_y = -1;
+   /* switch to the alternate screen, hide the cursor and clear the screen */
+   append("\033[?1049h\033[?25l\033[0m\033[2J", 22);
+   flushbuf();
+}
+
+/* Restore original screen state */
+static void ansi_close()
+{
+   int i;
+   append(restorescreen, sizeof(restorescreen) - 1);
+   flushbuf();
+   tcsetattr(STDIN_FILENO, TCSANOW, &oldtermios);
+   for (i = 0; i < NUMSIGNALS; i++) sigaction(signals[i], &oldactions[i], NULL);
+}
+
+/*
+ * Output
+ */
+
+/* Set color attributes */
+static void ansi_setattr(int attr)
+{
+   out_attr = attr;
+}
+
+/* Set color. Black on black is the terminal's default colors, like color pair 0 in curses */
+static void ansi_setcolor(int fg, int bg)
+{
+   char str[32];
+   if (out_attr == cur_attr && fg == cur_fg && bg == cur_bg) return;
+   if (fg == COLOR_BLACK && bg == COLOR_BLACK)
+	 append(str, snprintf(str, sizeof(str), "\033[0;%dm", out_attr));
+   else
+	 append(str, snprintf(str, sizeof(str), "\033[0;%d;%d;%dm", out_attr, 30 + fg, 40 + bg));
+   cur_attr = out_attr;
+   cur_fg = fg;
+   cur_bg = bg;
+}
+
+/* Move cursor to position (x,y) on the screen. Upper corner of screen is (0,0) */
+static void ansi_gotoxy(int x, int y)
+{
+   char str[32];
+   if (x == cur_x && y == cur_y) return;
+   append(str, snprintf(str, sizeof(str), "\033[%d;%dH", y + 1, x + 1));
+   cur_x = x;
+   cur_y = y;
+}
+
+/* Put a character on the screen */
+static void ansi_putch(char ch)
+{
+   append(&ch, 1);
+   if (cur_x >= 0) cur_x++;
+}
+
+/* Put a string on the screen */
+static void ansi_puts(const char *str)
+{
+   int len = strlen(str);
+   append(str, len);
+   if (cur_x >= 0) cur_x += len;
+}
+
+/* Refresh screen */
+static void ansi_refresh()
+{
+   flushbuf();
+}
+
+/* Get the screen width */
+static int ansi_width()
+{
+   struct winsize ws;
+   if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+   return DEFAULT_WIDTH;
+}
+
+/* Get the screen height */
+static int ansi_height()
+{
+   struct winsize ws;
+   if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) return ws.ws_row;
+   return DEFAULT_HEIGHT;
+}
+
+/* Beep */
+static void ansi_beep()
+{
+   append("\a", 1);
+}
+
+/* The terminal changed size */
+static void ansi_resize()
+{
+   append("\033[0m\033[2J", 8);
+   cur_attr = cur_fg = cur_bg = cur_x = cur_y = -1;
+}
+
+/*
+ * Input
+ */
+
+/* Read a character that is waiting */
+static int ansi_getch()
+{
+   struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+   unsigned char ch;
+   if (poll(&pfd, 1, 0) <= 0 || read(STDIN_FILENO, &ch, 1) != 1) return ERR;
+   return ch;
+}
+
+/* Empty keyboard buffer */
+static void ansi_flush()
+{
+   tcflush(STDIN_FILENO, TCIFLUSH);
+}
+
+const io_backend_t io_ansi =
+{
+   "ansi", "VT100 escape sequences, one write() per frame", TRUE,
+   ansi_init, ansi_close,
+   ansi_setattr, ansi_setcolor, ansi_gotoxy, ansi_putch, ansi_puts,
+   ansi_refresh, ansi_width, ansi_height, ansi_beep,
+   ansi_resize, ansi_getch, ansi_flush
+};
@@ -0,0 +1,64 @@
+#ifndef IO_BACKEND_H
+#define IO_BACKEND_H
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include "typedefs.h"		/* bool */
+
+/*
+ * I/O backends. The functions in io.h call the backend chosen with
+ * io_select(), see io.h for what each of these should do.
+ */
+
+typedef struct
+{
+   const char *name;
+   const char *description;
+   /*
+	* FALSE if there is no terminal to wait for. Time then stands still
+	* between gravity ticks, so runs are repeatable. Otherwise io.c polls
+	* stdin for keys and handles gravity & SIGWINCH itself.
+	*/
+   bool realtime;
+   /* Init & Close */
+   void (*init)();
+   void (*close)();
+   /* Output */
+   void (*setattr)(int attr);
+   void (*setcolor)(int fg, int bg);
+   void (*gotoxy)(int x, int y);
+   void (*putch)(char ch);
+   void (*puts)(const char *str);
+   void (*refresh)();
+   int (*width)();
+   int (*height)();
+   void (*beep)();
+   /* The terminal changed size. Clear the screen, it will be redrawn */
+   void (*resize)();
+   /* Input. Read a character that is waiting, without waiting for one (ERR if none) */
+   int (*getch)();
+   void (*flush)();
+} io_backend_t;
+
+/* Backends call this with the number of bytes they wrote to the terminal */
+void io_written(int n);
+
+/* TRUE if out_measure() asked us to count the bytes (backends may skip it otherwise if it's expensive) */
+extern bool io_measure;
+
+/* ncurses (io_curses.c) */
+extern const io_backend_t io_curses;
+
+/* VT100 escape sequences, written with one write() per frame (io_ansi.c) */
+extern const io_backend_t io_ansi;
+
+/* No terminal at all, for headless runs and benchmarks (io_null.c) */
+extern const io_backend_t io_null;
+
+#endif	/* #ifndef IO_BACKEND_H */
@@ -0,0 +1,217 @@
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <stdlib.h>		/* strtoul() */
+#include <string.h>		/* strstr() */
+#include <curses.h>
+#include <fcntl.h>		/* open() */
+#include <sys/ioctl.h>	/* ioctl(), TIOCGWINSZ */
+#include <unistd.h>		/* STDOUT_FILENO, pread(), close() */
+
+#include "io.h"
+#include "io_backend.h"
+
+/* Number of colors defined in io.h */
+#define NUM_COLORS	8
+
+/* Number of attributes defined in io.h */
+#define NUM_ATTRS	9
+
+/* Cursor definitions */
+#define CURSOR_INVISIBLE	0
+#define CURSOR_NORMAL		1
+
+/* Maps color definitions onto their real definitions */
+static int color_map[NUM_COLORS];
+
+/* Maps attribute definitions onto their real definitions */
+static int attr_map[NUM_ATTRS];
+
+/* Maps foreground & background colors onto their (preallocated) color pairs */
+static int pair_map[NUM_COLORS][NUM_COLORS];
+
+/* Current attribute used on screen */
+static int out_attr;
+
+/* Attributes & color pair last passed to attrset() (-1 = unknown) */
+static int out_current;
+
+/*
+ * Init & Close
+ */
+
+/* /proc/self/io, to see how much curses wrote (-1 if we're not counting) */
+static int procio = -1;
+
+/* Total number of bytes written by this process so far */
+static unsigned long written()
+{
+   char buf[512],*str;
+   int n = pread(procio, buf, sizeof(buf) - 1, 0);
+   if (n <= 0) return 0;
+   buf[n] = '\0';
+   return (str = strstr(buf, "wchar:")) != NULL ? strtoul(str + 6, NULL, 10) : 0;
+}
+
+/* Initialize screen */
+static void curses_init()
+{
+   int fg,bg,pair;
+   initscr();
+   /* curses writes to the terminal itself, the kernel counts the bytes for us */
+   if (io_measure) procio = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+   start_color();
+   curs_set(CURSOR_INVISIBLE);
+   out_attr = A_NORMAL;
+   out_current = -1;
+   noecho();
+   nodelay(stdscr, TRUE);
+   /* Map colors */
+   color_map[COLOR_BLACK] = COLOR_BLACK;
+   color_map[COLOR_RED] = COLOR_RED;
+   color_map[COLOR_GREEN] = COLOR_GREEN;
+   color_map[COLOR_YELLOW] = COLOR_YELLOW;
+   color_map[COLOR_BLUE] = COLOR_BLUE;
+   color_map[COLOR_MAGENTA] = COLOR_MAGENTA;
+   color_map[COLOR_CYAN] = COLOR_CYAN;
+   color_map[COLOR_WHITE] = COLOR_WHITE;
+   /* Map attributes */
+   attr_map[ATTR_OFF] = A_NORMAL;
+   attr_map[ATTR_BOLD] = A_BOLD;
+   attr_map[ATTR_DIM] = A_DIM;
+   attr_map[ATTR_UNDERLINE] = A_UNDERLINE;
+   attr_map[ATTR_BLINK] = A_BLINK;
+   attr_map[ATTR_REVERSE] = A_REVERSE;
+   attr_map[ATTR_INVISIBLE] = A_INVIS;
+   /* Register all the color pairs up front (pair 0 is the terminal default and can't be changed) */
+   for (bg = 0; bg < NUM_COLORS; bg++) for (fg = 0; fg < NUM_COLORS; fg++)
+	 {
+		pair = (bg << 3) + fg;
+		if (pair > 0 && pair < COLOR_PAIRS) init_pair(pair, color_map[fg], color_map[bg]);
+		pair_map[fg][bg] = COLOR_PAIR(pair);
+	 }
+}
+
+/* Restore original screen state */
+static void curses_close()
+{
+   echo();
+   attrset(A_NORMAL);
+   out_current = A_NORMAL;
+   clear();
+   curs_set(CURSOR_NORMAL);
+   refresh();
+   endwin();
+   if (procio >= 0) close(procio);
+   procio = -1;
+}
+
+/*
+ * Output
+ */
+
+/* Set color attributes */
+static void curses_setattr(int attr)
+{
+   out_attr = attr_map[attr];
+}
+
+/* Set color */
+static void curses_setcolor(int fg, int bg)
+{
+   int attr = pair_map[fg][bg] | out_attr;
+   if (attr != out_current)
+	 {
+		attrset(attr);
+		out_current = attr;
+	 }
+}
+
+/* Move cursor to position (x,y) on the screen. Upper corner of screen is (0,0) */
+static void curses_gotoxy(int x, int y)
+{
+   move(y, x);
+}
+
+/* Put a character on the screen */
+static void curses_putch(char ch)
+{
+   addch(ch);
+}
+
+/* Put a string on the screen */
+static void curses_puts(const char *str)
+{
+   addstr(str);
+}
+
+/* Refresh screen */
+static void curses_refresh()
+{
+   unsigned long before;
+   if (procio < 0)
+	 {
+		refresh();
+		return;
+	 }
+   before = written();
+   refresh();
+   io_written(written() - before);
+}
+
+/* Get the screen width */
+static int curses_width()
+{
+   return COLS;
+}
+
+/* Get the screen height */
+static int curses_height()
+{
+   return LINES;
+}
+
+/* Beep */
+static void curses_beep()
+{
+   beep();
+}
+
+/* The terminal changed size */
+static void curses_resize()
+{
+   struct winsize ws;
+   if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) resizeterm(ws.ws_row, ws.ws_col);
+   clear();
+}
+
+/*
+ * Input
+ */
+
+/* Read a character that is waiting */
+static int curses_getch()
+{
+   return getch();
+}
+
+/* Empty keyboard buffer */
+static void curses_flush()
+{
+   flushinp();
+}
+
+const io_backend_t io_curses =
+{
+   "curses", "ncurses (default)", TRUE,
+   curses_init, curses_close,
+   curses_setattr, curses_setcolor, curses_gotoxy, curses_putch, curses_puts,
+   curses_refresh, curses_width, curses_height, curses_beep,
+   curses_resize, curses_getch, curses_flush
+};
@@ -0,0 +1,67 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Null backend. Nothing is drawn and the screen is always 80x24, so the
+ * whole game (rendering logic included) can run without a terminal.
+ * Gravity runs as fast as the CPU allows: the backend never waits for a
+ * key from a terminal. Keys from a file or pipe are handed out one per
+ * gravity tick (see in_wait()), so a script steers the whole game and
+ * scripted games are repeatable.
+ */
+
+#include <unistd.h>		/* read() */
+#include <poll.h>		/* poll() */
+
+#include "typedefs.h"
+#include "io.h"
+#include "io_backend.h"
+
+/* Size of the screen */
+#define WIDTH	80
+#define HEIGHT	24
+
+static void null_init() { }
+static void null_close() { }
+static void null_setattr(int attr) { }
+static void null_setcolor(int fg, int bg) { }
+static void null_gotoxy(int x, int y) { }
+static void null_putch(char ch) { }
+static void null_puts(const char *str) { }
+static void null_refresh() { }
+static int null_width() { return WIDTH; }
+static int null_height() { return HEIGHT; }
+static void null_beep() { }
+static void null_resize() { }
+static void null_flush() { }
+
+/* Set once there are no more keys to read */
+static bool eof;
+
+/* Read a character */
+static int null_getch()
+{
+   struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+   unsigned char ch;
+   if (eof || poll(&pfd, 1, isatty(STDIN_FILENO) ? 0 : -1) <= 0) return ERR;
+   if (read(STDIN_FILENO, &ch, 1) != 1)
+	 {
+		eof = TRUE;
+		return ERR;
+	 }
+   return ch;
+}
+
+const io_backend_t io_null =
+{
+   "null", "no terminal at all, for headless runs and benchmarks", FALSE,
+   null_init, null_close,
+   null_setattr, null_setcolor, null_gotoxy, null_putch, null_puts,
+   null_refresh, null_width, null_height, null_beep,
+   null_resize, null_getch, null_flush
+};
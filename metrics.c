@@ -0,0 +1,152 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <stdio.h>		/* fopen(), fprintf() */
+#include <string.h>		/* memset() */
+#include <signal.h>		/* sigaction() */
+#include <time.h>		/* clock_gettime(), time() */
+
+#include "typedefs.h"
+#include "metrics.h"
+
+/* Number of histogram buckets. Bucket i holds values in [2^(i-1),2^i), bucket 0 holds 0 */
+#define NUMBUCKETS	48
+
+/* Width of the longest bar in the histograms */
+#define BARWIDTH	40
+
+typedef struct
+{
+   unsigned long count;
+   int64_t sum,min,max;
+   unsigned long bucket[NUMBUCKETS];
+} histogram_t;
+
+/* Names & units of the metrics (in the same order as metric_t) */
+static const char *names[NUMMETRICS] = { "drawboard", "showstatus", "refresh", "latency", "bytes", "calls" };
+static const char *units[NUMMETRICS] = { "ns", "ns", "ns", "ns", "B", "calls" };
+
+bool metrics_enabled = FALSE;
+
+static histogram_t histogram[NUMMETRICS];
+static FILE *output;
+static int64_t started;
+
+/* Set by SIGUSR1 */
+static volatile sig_atomic_t requested;
+
+static void sigusr1(int sig)
+{
+   requested = TRUE;
+}
+
+/* Current time in nanoseconds (monotonic, only the differences mean anything) */
+int64_t metrics_now()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Start measuring. The report is written to filename at exit and on SIGUSR1. Returns OK or ERR */
+int metrics_open(const char *filename)
+{
+   struct sigaction sa;
+   if ((output = fopen(filename, "w")) == NULL) return ERR;
+   memset(histogram, 0, sizeof(histogram));
+   /* no SA_RESTART, so that the signal wakes up poll() in in_wait() */
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = sigusr1;
+   sigemptyset(&sa.sa_mask);
+   sigaction(SIGUSR1, &sa, NULL);
+   started = metrics_now();
+   metrics_enabled = TRUE;
+   return OK;
+}
+
+/* Add a value to a histogram */
+void metrics_add(metric_t metric, int64_t value)
+{
+   histogram_t *h = histogram + metric;
+   int i = 0;
+   if (value < 0) value = 0;
+   while (i < NUMBUCKETS - 1 && value >> i) i++;
+   h->bucket[i]++;
+   if (!h->count || value < h->min) h->min = value;
+   if (!h->count || value > h->max) h->max = value;
+   h->count++;
+   h->sum += value;
+}
+
+/* Upper bound of the bucket the p'th percentile falls in (but never more than the maximum) */
+static int64_t percentile(const histogram_t *h, int p)
+{
+   unsigned long n = 0, wanted = (h->count * p + 99) / 100;
+   int i;
+   for (i = 0; i < NUMBUCKETS; i++)
+	 if ((n += h->bucket[i]) >= wanted) break;
+   if (i == 0) return 0;
+   return ((int64_t) 1 << i) - 1 < h->max ? ((int64_t) 1 << i) - 1 : h->max;
+}
+
+/* Write the summary and histograms */
+static void report()
+{
+   const histogram_t *h;
+   unsigned long most;
+   int i,j,first,last;
+   double elapsed = (metrics_now() - started) / 1e9;
+   fprintf(output, "# tint metrics at %ld (%.3f seconds, %lu frames)\n", (long) time(NULL), elapsed, histogram[METRIC_REFRESH].count);
+   fprintf(output, "%-12s %-6s %10s %12s %12s %12s %12s %12s %12s %14s\n",
+		   "metric", "unit", "count", "mean", "min", "p50", "p90", "p99", "max", "total");
+   for (i = 0; i < NUMMETRICS; i++)
+	 {
+		h = histogram + i;
+		fprintf(output, "%-12s %-6s %10lu %12.0f %12lld %12lld %12lld %12lld %12lld %14lld\n",
+				names[i], units[i], h->count, h->count ? (double) h->sum / h->count : 0.0,
+				(long long) h->min, (long long) percentile(h, 50), (long long) percentile(h, 90),
+				(long long) percentile(h, 99), (long long) h->max, (long long) h->sum);
+	 }
+   if (elapsed > 0)
+	 fprintf(output, "# %.0f bytes/second, %.1f frames/second\n",
+			 histogram[METRIC_BYTES].sum / elapsed, histogram[METRIC_REFRESH].count / elapsed);
+   for (i = 0; i < NUMMETRICS; i++)
+	 {
+		h = histogram + i;
+		if (!h->count) continue;
+		fprintf(output, "\n## %s (%s)\n", names[i], units[i]);
+		first = 0, last = NUMBUCKETS - 1, most = 0;
+		while (!h->bucket[first]) first++;
+		while (!h->bucket[last]) last--;
+		for (j = first; j <= last; j++) if (h->bucket[j] > most) most = h->bucket[j];
+		for (j = first; j <= last; j++)
+		  fprintf(output, "%14lld .. %-14lld %10lu %.*s\n",
+				  j ? (long long) 1 << (j - 1) : 0LL, ((long long) 1 << j) - 1, h->bucket[j],
+				  (int) (h->bucket[j] * BARWIDTH / most), "########################################");
+	 }
+   fprintf(output, "\n");
+   fflush(output);
+}
+
+/* Write the report now if SIGUSR1 asked for it */
+void metrics_poll()
+{
+   if (!requested) return;
+   requested = FALSE;
+   report();
+}
+
+/* Write the final report and stop measuring */
+void metrics_close()
+{
+   if (!metrics_enabled) return;
+   report();
+   fclose(output);
+   signal(SIGUSR1, SIG_DFL);
+   metrics_enabled = FALSE;
+}
@@ -0,0 +1,51 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <stdint.h>			/* int64_t */
+
+#include "typedefs.h"		/* bool */
+
+/*
+ * Render path instrumentation. Nothing is measured unless metrics_open()
+ * was called, so the only cost otherwise is checking metrics_enabled.
+ */
+
+/* What we measure (one histogram each) */
+typedef enum
+{
+   METRIC_DRAWBOARD,		/* time spent in drawboard() (ns) */
+   METRIC_SHOWSTATUS,		/* time spent in showstatus() (ns) */
+   METRIC_REFRESH,			/* time spent in out_refresh() (ns) */
+   METRIC_LATENCY,			/* time from a key arriving to the screen showing it (ns) */
+   METRIC_BYTES,			/* bytes written to the terminal per frame */
+   METRIC_CALLS,			/* out_* calls per frame */
+   NUMMETRICS
+} metric_t;
+
+/* TRUE if we are measuring */
+extern bool metrics_enabled;
+
+/* Start measuring. The report is written to filename at exit and on SIGUSR1. Returns OK or ERR */
+int metrics_open(const char *filename);
+
+/* Write the final report and stop measuring */
+void metrics_close();
+
+/* Current time in nanoseconds (monotonic, only the differences mean anything) */
+int64_t metrics_now();
+
+/* Add a value to a histogram */
+void metrics_add(metric_t metric, int64_t value);
+
+/* Write the report now if SIGUSR1 asked for it */
+void metrics_poll();
+
+#endif	/* #ifndef METRICS_H */
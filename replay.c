@@ -0,0 +1,396 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <stdio.h>		/* fopen(), fputc(), fgetc() */
+#include <stdlib.h>		/* realloc(), free() */
+#include <string.h>		/* memcmp() */
+#include <limits.h>		/* INT_MAX, INT_MIN */
+
+#include "typedefs.h"
+#include "replay.h"
+
+/* First bytes of every replay */
+#define MAGIC		"TINT"
+#define MAGICLEN	4
+
+/* Last bytes of a replay with an index */
+#define INDEXMAGIC	"TIDX"
+
+/* Size of the trailer (offset of the index & INDEXMAGIC) */
+#define TRAILERLEN	(8 + MAGICLEN)
+
+/* Number of varints in a keyframe (level, flags, shapecount, seed, score, status, rows, heights, shape) */
+#define KEYFRAMEVARINTS	(2 + NUMSHAPES + 7 + NUMROWS - 2 + NUMCOLS - 3 + 5)
+
+/* Where the rows, heights & current shape are among them */
+#define ROWVARINT		(2 + NUMSHAPES + 7)
+#define HEIGHTVARINT	(ROWVARINT + NUMROWS - 2)
+#define SHAPEVARINT		(HEIGHTVARINT + NUMCOLS - 3)
+
+/* Where the score & status are among them (signed) */
+#define SCOREVARINT	(2 + NUMSHAPES + 1)
+
+/* Most bytes a keyframe takes (a varint is at most 10 bytes) */
+#define KEYFRAMELEN	(10 * KEYFRAMEVARINTS)
+
+/*
+ * Varints
+ */
+
+static int putvarint(FILE *fp, uint64_t value)
+{
+   while (value >= 0x80)
+	 {
+		if (fputc((int) (value & 0x7f) | 0x80, fp) == EOF) return ERR;
+		value >>= 7;
+	 }
+   return fputc((int) value, fp) == EOF ? ERR : OK;
+}
+
+static unsigned char *bufvarint(unsigned char *buf, uint64_t value)
+{
+   while (value >= 0x80)
+	 {
+		*buf++ = (value & 0x7f) | 0x80;
+		value >>= 7;
+	 }
+   *buf++ = value;
+   return buf;
+}
+
+/* Map signed numbers to unsigned ones so that small negative numbers stay small */
+static uint64_t zigzag(int64_t value)
+{
+   return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+   return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static int getvarint(FILE *fp, uint64_t *value)
+{
+   int ch,shift = 0;
+   *value = 0;
+   do
+	 {
+		if (shift > 63 || (ch = fgetc(fp)) == EOF) return ERR;
+		*value |= (uint64_t) (ch & 0x7f) << shift;
+		shift += 7;
+	 }
+   while (ch & 0x80);
+   return OK;
+}
+
+/*
+ * Keyframes
+ */
+
+/* Encode a keyframe (without its tick) in buf. Returns the number of bytes used */
+static int encode(unsigned char *buf, const keyframe_t *keyframe)
+{
+   const snapshot_t *snapshot = &keyframe->snapshot;
+   unsigned char *p = buf;
+   int i;
+   p = bufvarint(p, keyframe->level);
+   p = bufvarint(p, keyframe->flags);
+   for (i = 0; i < NUMSHAPES; i++) p = bufvarint(p, keyframe->shapecount[i]);
+   p = bufvarint(p, snapshot->seed);
+   p = bufvarint(p, zigzag(snapshot->score));
+   p = bufvarint(p, zigzag(snapshot->status.moves));
+   p = bufvarint(p, zigzag(snapshot->status.rotations));
+   p = bufvarint(p, zigzag(snapshot->status.dropcount));
+   p = bufvarint(p, zigzag(snapshot->status.efficiency));
+   p = bufvarint(p, zigzag(snapshot->status.droppedlines));
+   for (i = 0; i < NUMROWS - 2; i++) p = bufvarint(p, snapshot->row[i]);
+   for (i = 0; i < NUMCOLS - 3; i++) p = bufvarint(p, snapshot->height[i]);
+   p = bufvarint(p, zigzag(snapshot->curx));
+   p = bufvarint(p, zigzag(snapshot->cury));
+   p = bufvarint(p, zigzag(snapshot->curshape));
+   p = bufvarint(p, zigzag(snapshot->nextshape));
+   p = bufvarint(p, zigzag(snapshot->curorient));
+   return p - buf;
+}
+
+/* Read a keyframe (without its tick) from the file. Returns OK or ERR */
+static int decode(FILE *fp, keyframe_t *keyframe)
+{
+   snapshot_t *snapshot = &keyframe->snapshot;
+   uint64_t value[KEYFRAMEVARINTS];
+   const uint64_t *v = value;
+   int i;
+   for (i = 0; i < KEYFRAMEVARINTS; i++)
+	 if (getvarint(fp, value + i) != OK) return ERR;
+   /* the rows, heights & the current shape have to fit before they can be checked */
+   for (i = ROWVARINT; i < HEIGHTVARINT; i++)
+	 if (value[i] > FULLROW) return ERR;
+   for (i = HEIGHTVARINT; i < SHAPEVARINT; i++)
+	 if (value[i] > NUMROWS - 2) return ERR;
+   for (i = SHAPEVARINT; i < KEYFRAMEVARINTS; i++)
+	 if (value[i] > 2 * NUMROWS) return ERR;
+   /* the level, flags, shape counts, score & status have to fit in an int */
+   for (i = 0; i < SCOREVARINT - 1; i++)
+	 if (value[i] > INT_MAX) return ERR;
+   for (i = SCOREVARINT; i < ROWVARINT; i++)
+	 if (unzigzag(value[i]) < INT_MIN || unzigzag(value[i]) > INT_MAX) return ERR;
+   memset(keyframe, 0, sizeof(keyframe_t));
+   keyframe->level = *v++;
+   keyframe->flags = *v++;
+   for (i = 0; i < NUMSHAPES; i++) keyframe->shapecount[i] = *v++;
+   snapshot->seed = *v++;
+   snapshot->score = unzigzag(*v++);
+   snapshot->status.moves = unzigzag(*v++);
+   snapshot->status.rotations = unzigzag(*v++);
+   snapshot->status.dropcount = unzigzag(*v++);
+   snapshot->status.efficiency = unzigzag(*v++);
+   snapshot->status.droppedlines = unzigzag(*v++);
+   for (i = 0; i < NUMROWS - 2; i++) snapshot->row[i] = *v++;
+   for (i = 0; i < NUMCOLS - 3; i++) snapshot->height[i] = *v++;
+   snapshot->curx = unzigzag(*v++);
+   snapshot->cury = unzigzag(*v++);
+   snapshot->curshape = unzigzag(*v++);
+   snapshot->nextshape = unzigzag(*v++);
+   snapshot->curorient = unzigzag(*v++);
+   /* a damaged (or made up) snapshot could put the shape outside the board */
+   return engine_check(snapshot) ? OK : ERR;
+}
+
+/* Compare two keyframes. Returns 0 if the games are in the same state */
+int replay_compare(const keyframe_t *a, const keyframe_t *b)
+{
+   unsigned char bufa[KEYFRAMELEN],bufb[KEYFRAMELEN];
+   int lena,lenb;
+   if (a->tick != b->tick) return a->tick < b->tick ? -1 : 1;
+   /* the snapshots have padding, so compare them encoded */
+   lena = encode(bufa, a);
+   lenb = encode(bufb, b);
+   if (lena != lenb) return lena - lenb;
+   return memcmp(bufa, bufb, lena);
+}
+
+/*
+ * Recording
+ */
+
+/* Start recording a game to filename. Returns OK or ERR */
+int replay_create(replay_t *replay, const char *filename, uint64_t seed, int level, int flags)
+{
+   if ((replay->fp = fopen(filename, "wb")) == NULL) return ERR;
+   replay->level = level;
+   replay->flags = flags;
+   replay->seed = seed;
+   replay->tick = replay->events = 0;
+   replay->score = replay->lines = 0;
+   replay->index = NULL;
+   replay->keyframes = replay->size = 0;
+   if (fwrite(MAGIC, MAGICLEN, 1, replay->fp) != 1 ||
+	   putvarint(replay->fp, REPLAY_VERSION) != OK ||
+	   putvarint(replay->fp, level) != OK ||
+	   putvarint(replay->fp, flags) != OK ||
+	   putvarint(replay->fp, seed) != OK)
+	 {
+		replay_close(replay);
+		return ERR;
+	 }
+   replay->start = ftell(replay->fp);
+   return OK;
+}
+
+/* Record an event that happened after gravity tick number tick. Returns OK or ERR */
+int replay_write(replay_t *replay, uint64_t tick, int event)
+{
+   uint64_t ticks = tick - replay->tick;
+   replay->tick = tick;
+   if (event != REPLAY_KEYFRAME && event != REPLAY_END) replay->events++;
+   return putvarint(replay->fp, (ticks << 4) | event);
+}
+
+/* Record the state of the game (call it right after a shape was locked). Returns OK or ERR */
+int replay_keyframe(replay_t *replay, const keyframe_t *keyframe)
+{
+   unsigned char buf[KEYFRAMELEN];
+   replay_index_t *index;
+   int len;
+   if (replay->keyframes == replay->size)
+	 {
+		if ((index = realloc(replay->index, (replay->size * 2 + 16) * sizeof(replay_index_t))) == NULL) return ERR;
+		replay->index = index;
+		replay->size = replay->size * 2 + 16;
+	 }
+   if (replay_write(replay, keyframe->tick, REPLAY_KEYFRAME) != OK) return ERR;
+   index = replay->index + replay->keyframes++;
+   index->tick = replay->tick;
+   index->events = replay->events;
+   index->offset = ftell(replay->fp);
+   len = encode(buf, keyframe);
+   return fwrite(buf, len, 1, replay->fp) == 1 ? OK : ERR;
+}
+
+/* Write the index of the keyframes. Returns OK or ERR */
+static int putindex(replay_t *replay)
+{
+   unsigned char trailer[TRAILERLEN];
+   long offset = ftell(replay->fp);
+   int i;
+   if (offset < 0 || putvarint(replay->fp, replay->keyframes) != OK) return ERR;
+   for (i = 0; i < replay->keyframes; i++)
+	 if (putvarint(replay->fp, replay->index[i].tick) != OK ||
+		 putvarint(replay->fp, replay->index[i].events) != OK ||
+		 putvarint(replay->fp, replay->index[i].offset) != OK)
+	   return ERR;
+   for (i = 0; i < 8; i++) trailer[i] = (uint64_t) offset >> (8 * i);
+   memcpy(trailer + 8, INDEXMAGIC, MAGICLEN);
+   return fwrite(trailer, TRAILERLEN, 1, replay->fp) == 1 ? OK : ERR;
+}
+
+/* Record the end of the game, write the index and close the file. Returns OK or ERR */
+int replay_finish(replay_t *replay, uint64_t tick, int score, int lines)
+{
+   int result = OK;
+   replay->score = score;
+   replay->lines = lines;
+   if (replay_write(replay, tick, REPLAY_END) != OK ||
+	   putvarint(replay->fp, score) != OK ||
+	   putvarint(replay->fp, lines) != OK ||
+	   putindex(replay) != OK)
+	 result = ERR;
+   if (fclose(replay->fp) != 0) result = ERR;
+   replay->fp = NULL;
+   replay_close(replay);
+   return result;
+}
+
+/*
+ * Playback
+ */
+
+/* Read the index of the keyframes (if there is one). Returns OK or ERR */
+static int getindex(replay_t *replay)
+{
+   unsigned char trailer[TRAILERLEN];
+   uint64_t count,tick,events,offset = 0;
+   long size;
+   int i;
+   /* an incomplete recording has no index, and that's fine */
+   if (fseek(replay->fp, -TRAILERLEN, SEEK_END) != 0 ||
+	   fread(trailer, TRAILERLEN, 1, replay->fp) != 1 ||
+	   memcmp(trailer + 8, INDEXMAGIC, MAGICLEN) != 0)
+	 return OK;
+   size = ftell(replay->fp);
+   for (i = 0; i < 8; i++) offset |= (uint64_t) trailer[i] << (8 * i);
+   if (offset < replay->start || offset >= size ||
+	   fseek(replay->fp, offset, SEEK_SET) != 0 ||
+	   getvarint(replay->fp, &count) != OK || count > size)
+	 return ERR;
+   if (count && (replay->index = malloc(count * sizeof(replay_index_t))) == NULL) return ERR;
+   replay->size = count;
+   for (i = 0; i < count; i++)
+	 {
+		if (getvarint(replay->fp, &tick) != OK ||
+			getvarint(replay->fp, &events) != OK ||
+			getvarint(replay->fp, &offset) != OK ||
+			offset < replay->start || offset >= size)
+		  return ERR;
+		replay->index[i].tick = tick;
+		replay->index[i].events = events;
+		replay->index[i].offset = offset;
+	 }
+   replay->keyframes = count;
+   return OK;
+}
+
+/* Open a recorded game and read its header and index. Returns OK or ERR (not a replay) */
+int replay_open(replay_t *replay, const char *filename)
+{
+   char magic[MAGICLEN];
+   uint64_t version,level,flags;
+   if ((replay->fp = fopen(filename, "rb")) == NULL) return ERR;
+   replay->tick = replay->events = 0;
+   replay->score = replay->lines = 0;
+   replay->index = NULL;
+   replay->keyframes = replay->size = 0;
+   if (fread(magic, MAGICLEN, 1, replay->fp) != 1 || memcmp(magic, MAGIC, MAGICLEN) != 0 ||
+	   getvarint(replay->fp, &version) != OK || version < 1 || version > REPLAY_VERSION ||
+	   getvarint(replay->fp, &level) != OK ||
+	   getvarint(replay->fp, &flags) != OK ||
+	   getvarint(replay->fp, &replay->seed) != OK ||
+	   (replay->start = ftell(replay->fp)) < 0 ||
+	   (version > 1 && getindex(replay) != OK) ||
+	   fseek(replay->fp, replay->start, SEEK_SET) != 0)
+	 {
+		replay_close(replay);
+		return ERR;
+	 }
+   replay->level = level;
+   replay->flags = flags;
+   return OK;
+}
+
+/* Read the next event and the gravity tick it happened after. Returns OK or ERR. The state of the game is in replay->keyframe after a REPLAY_KEYFRAME */
+int replay_read(replay_t *replay, uint64_t *tick, int *event)
+{
+   uint64_t value,score,lines;
+   if (getvarint(replay->fp, &value) != OK) return ERR;
+   replay->tick += value >> 4;
+   *tick = replay->tick;
+   *event = value & 15;
+   if (*event == REPLAY_KEYFRAME)
+	 {
+		if (decode(replay->fp, &replay->keyframe) != OK) return ERR;
+		replay->keyframe.tick = replay->tick;
+	 }
+   else if (*event == REPLAY_END)
+	 {
+		if (getvarint(replay->fp, &score) != OK || getvarint(replay->fp, &lines) != OK) return ERR;
+		replay->score = score;
+		replay->lines = lines;
+	 }
+   else replay->events++;
+   return OK;
+}
+
+/* Find the last keyframe at or before gravity tick number tick. Returns its number, or -1 if there is none */
+int replay_find(const replay_t *replay, uint64_t tick)
+{
+   int lo = 0,hi = replay->keyframes,mid;
+   /* binary search for the first keyframe after tick */
+   while (lo < hi)
+	 {
+		mid = (lo + hi) / 2;
+		if (replay->index[mid].tick <= tick) lo = mid + 1; else hi = mid;
+	 }
+   return lo - 1;
+}
+
+/* Carry on reading after keyframe n (read into replay->keyframe), or from the first event if n is -1. Returns OK or ERR */
+int replay_seek(replay_t *replay, int n)
+{
+   if (n < 0)
+	 {
+		replay->tick = replay->events = 0;
+		return fseek(replay->fp, replay->start, SEEK_SET) == 0 ? OK : ERR;
+	 }
+   if (n >= replay->keyframes ||
+	   fseek(replay->fp, replay->index[n].offset, SEEK_SET) != 0 ||
+	   decode(replay->fp, &replay->keyframe) != OK)
+	 return ERR;
+   replay->tick = replay->keyframe.tick = replay->index[n].tick;
+   replay->events = replay->index[n].events;
+   return OK;
+}
+
+/* Close the file (without finishing a recording) */
+void replay_close(replay_t *replay)
+{
+   if (replay->fp != NULL) fclose(replay->fp);
+   replay->fp = NULL;
+   free(replay->index);
+   replay->index = NULL;
+   replay->keyframes = replay->size = 0;
+}
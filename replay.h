@@ -0,0 +1,133 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ * 
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+#include <stdio.h>			/* FILE */
+#include <stdint.h>			/* uint64_t */
+
+#include "engine.h"			/* ACTION_* */
+
+/*
+ * Replays. A replay is everything needed to play a game again exactly:
+ * the seed, the starting level and options, and what the player did at
+ * which gravity tick. Time is counted in gravity ticks (calls to
+ * engine_evaluate()), so a replay plays back the same at any speed.
+ *
+ * File format (all numbers are unsigned LEB128 varints):
+ *
+ *    "TINT" REPLAY_VERSION level flags seed
+ *    events...
+ *    ((ticks << 4) | REPLAY_END) score lines
+ *    index
+ *
+ * where each event is ((ticks << 4) | event) and ticks is the number of
+ * gravity ticks since the previous event. Most events take one byte.
+ *
+ * Every now and then the recording has a keyframe, a copy of the state of
+ * the game right after a shape was locked:
+ *
+ *    ((ticks << 4) | REPLAY_KEYFRAME) level flags shapecount... snapshot
+ *
+ * where the snapshot is stored field by field (signed numbers zigzag
+ * encoded). The index at the end lists where the keyframes are, so that
+ * playback can start from any of them without going through the events
+ * before it:
+ *
+ *    count (tick events offset)... offset-of-index (8 bytes LE) "TIDX"
+ *
+ * where events is the number of events before the keyframe and offset is
+ * where its level is in the file.
+ */
+
+/* Version of the file format (version 1 had no keyframes) */
+#define REPLAY_VERSION	2
+
+/* Events (the moves are the same as the engine's actions) */
+#define REPLAY_LEFT		ACTION_LEFT
+#define REPLAY_ROTATE	ACTION_ROTATE
+#define REPLAY_RIGHT	ACTION_RIGHT
+#define REPLAY_DROP		ACTION_DROP
+#define REPLAY_DOWN		ACTION_DOWN
+#define REPLAY_SHOWNEXT	5			/* start showing the next shape */
+#define REPLAY_DOTTED	6			/* toggle dotted lines */
+#define REPLAY_LEVELUP	7			/* next level */
+#define REPLAY_KEYFRAME	14			/* state of the game (not an event, see above) */
+#define REPLAY_END		15			/* game over (or the player quit) */
+
+/* Flags (options the game started with, or has at a keyframe) */
+#define REPLAY_FLAG_SHOWNEXT	1
+#define REPLAY_FLAG_DOTTED		2
+
+/* State of the game at a keyframe */
+typedef struct
+{
+   uint64_t tick;					/* gravity ticks before the keyframe */
+   int level,flags;					/* level and flags at the time */
+   int shapecount[NUMSHAPES];		/* number of each shape released so far */
+   snapshot_t snapshot;				/* the engine */
+} keyframe_t;
+
+/* Where a keyframe is in the file */
+typedef struct
+{
+   uint64_t tick,events;
+   long offset;
+} replay_index_t;
+
+typedef struct
+{
+   FILE *fp;
+   /* Header */
+   int level,flags;
+   uint64_t seed;
+   /* Gravity ticks & number of events up to the last event read or written */
+   uint64_t tick,events;
+   /* Result of the game (only known once REPLAY_END was read) */
+   int score,lines;
+   /* The last keyframe read */
+   keyframe_t keyframe;
+   /* Keyframes in the file (empty if the recording is incomplete) */
+   replay_index_t *index;
+   int keyframes,size;
+   /* Where the first event is */
+   long start;
+} replay_t;
+
+/* Start recording a game to filename. Returns OK or ERR */
+int replay_create(replay_t *replay, const char *filename, uint64_t seed, int level, int flags);
+
+/* Record an event that happened after gravity tick number tick. Returns OK or ERR */
+int replay_write(replay_t *replay, uint64_t tick, int event);
+
+/* Record the state of the game (call it right after a shape was locked). Returns OK or ERR */
+int replay_keyframe(replay_t *replay, const keyframe_t *keyframe);
+
+/* Compare two keyframes. Returns 0 if the games are in the same state */
+int replay_compare(const keyframe_t *a, const keyframe_t *b);
+
+/* Record the end of the game, write the index and close the file. Returns OK or ERR */
+int replay_finish(replay_t *replay, uint64_t tick, int score, int lines);
+
+/* Open a recorded game and read its header and index. Returns OK or ERR (not a replay) */
+int replay_open(replay_t *replay, const char *filename);
+
+/* Read the next event and the gravity tick it happened after. Returns OK or ERR. The state of the game is in replay->keyframe after a REPLAY_KEYFRAME */
+int replay_read(replay_t *replay, uint64_t *tick, int *event);
+
+/* Find the last keyframe at or before gravity tick number tick. Returns its number, or -1 if there is none */
+int replay_find(const replay_t *replay, uint64_t tick);
+
+/* Carry on reading after keyframe n (read into replay->keyframe), or from the first event if n is -1. Returns OK or ERR */
+int replay_seek(replay_t *replay, int n);
+
+/* Close the file (without finishing a recording) */
+void replay_close(replay_t *replay);
+
+#endif	/* #ifndef REPLAY_H */
@@ -0,0 +1,717 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Game server: one process hosts a game for every client connected to a
+ * Unix domain socket (see tint-client). Everything runs in a single epoll
+ * loop. Gravity for all the games comes from one timer wheel, and each
+ * game keeps a copy of what its client's terminal shows, so only the cells
+ * that changed are sent, as VT100 escape sequences.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "typedefs.h"
+#include "engine.h"
+#include "game.h"
+
+/*
+ * Macros
+ */
+
+/* Where the server listens if -s isn't given */
+#define DEFAULTSOCKET	"/tmp/tint.sock"
+
+/* Default for the most games at the same time */
+#define DEFAULTSESSIONS	1024
+
+/* Descriptors that aren't sessions (stdin, stdout, stderr, the listening socket, epoll & the spare) */
+#define RESERVEDFDS	6
+
+/* Size of the part of the screen a game is drawn on */
+#define WIDTH	50
+#define HEIGHT	22
+
+/* Where the status panel is */
+#define PANELX	((NUMCOLS - 1) * 2 + 3)
+
+/* Output waiting for the client (a frame that doesn't fit is finished once it is written) */
+#define OUTSIZE	1024
+
+/* Timer wheel: microseconds per slot and number of slots */
+#define RESOLUTION	10000
+#define WHEELSIZE	64
+
+/* Most events handled per epoll_wait() */
+#define MAXEVENTS	64
+
+/* Keys read from a client at a time */
+#define KEYSIZE	64
+
+/* Attributes of a cell (fg | bg << 3 | BOLD) */
+#define BOLD	64
+
+/*
+ * Type definitions
+ */
+
+/* A character on the client's screen (0xff = unknown) */
+typedef struct
+{
+   unsigned char ch,attr;
+} cell_t;
+
+typedef struct session_struct
+{
+   int fd;							/* -1 once the client is gone */
+   game_t game;
+   bool paused,over;
+   /* Gravity (in the timer wheel while the game is running) */
+   int64_t expires;				/* time of the next gravity tick */
+   int slot;						/* slot of the wheel it is in (-1 = none) */
+   struct session_struct *prev,*next;
+   /* Drawing */
+   struct session_struct *nextdirty;
+   bool dirty;						/* on the dirty list */
+   bool writing;					/* waiting for the socket to be writable */
+   bool clear;						/* the terminal has to be cleared first */
+   cell_t screen[HEIGHT][WIDTH];	/* what the client's terminal shows once out is written */
+   int attr,x,y;					/* attribute & cursor of the terminal (-1 = unknown) */
+   char out[OUTSIZE];
+   int outlen;
+} session_t;
+
+/*
+ * Global variables
+ */
+
+static const char *socketfile = DEFAULTSOCKET;
+static int maxsessions = DEFAULTSESSIONS;
+static int startlevel = MINLEVEL;
+
+static int epfd,listenfd;
+static int sparefd = -1;			/* kept to turn clients away when we run out of descriptors */
+static int sessions;
+static volatile sig_atomic_t finished;
+
+/* Gravity: the sessions in each slot & the start of the next slot to run */
+static session_t *wheel[WHEELSIZE];
+static int64_t wheeltime;
+static int timers;
+
+/* Sessions to draw (or free) at the end of the loop */
+static session_t *dirty;
+
+/*
+ * Functions
+ */
+
+/* Convert a string to integer. Returns TRUE if successful, FALSE otherwise. */
+static bool strtoint(int *i, const char *str)
+{
+   char *endptr;
+   long val = strtol(str, &endptr, 0);
+   if (*str == '\0' || *endptr != '\0' || val == LONG_MIN || val == LONG_MAX || val < INT_MIN || val > INT_MAX) return FALSE;
+   *i = (int)val;
+   return TRUE;
+}
+
+/* Current time in microseconds */
+static int64_t now()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Timer wheel
+ */
+
+/* Run the gravity of a session at the time in session->expires */
+static void schedule(session_t *session)
+{
+   int slot = (session->expires / RESOLUTION) % WHEELSIZE;
+   session->slot = slot;
+   session->prev = NULL;
+   session->next = wheel[slot];
+   if (wheel[slot] != NULL) wheel[slot]->prev = session;
+   wheel[slot] = session;
+   timers++;
+}
+
+/* Take a session out of the wheel */
+static void unschedule(session_t *session)
+{
+   if (session->slot < 0) return;
+   if (session->prev != NULL) session->prev->next = session->next;
+   else wheel[session->slot] = session->next;
+   if (session->next != NULL) session->next->prev = session->prev;
+   session->slot = -1;
+   timers--;
+}
+
+/* Milliseconds until the next slot with a timer that expires has to run (-1 if there are no timers) */
+static int nexttimeout(int64_t t)
+{
+   const session_t *session;
+   int64_t start,expires = INT64_MAX;
+   int i;
+   if (!timers) return -1;
+   if (wheeltime + RESOLUTION <= t) return 0;
+   /* the first slot with a timer for this time round the wheel, otherwise the earliest timer of a later round */
+   for (i = 0, start = wheeltime; i < WHEELSIZE && expires >= start; i++, start += RESOLUTION)
+	 for (session = wheel[(start / RESOLUTION) % WHEELSIZE]; session != NULL; session = session->next)
+	   if (session->expires < expires) expires = session->expires;
+   /* a slot runs once all of it has passed (see runtimers()) */
+   if (expires < wheeltime) expires = wheeltime;
+   expires += RESOLUTION - expires % RESOLUTION;
+   return expires <= t ? 0 : (expires - t + 999) / 1000;
+}
+
+/*
+ * Drawing
+ */
+
+/* Draw a session at the end of the loop */
+static void touch(session_t *session)
+{
+   if (session->dirty) return;
+   session->dirty = TRUE;
+   session->nextdirty = dirty;
+   dirty = session;
+}
+
+/* Add escape sequences to the output. Returns FALSE if they don't fit */
+static bool emit(session_t *session, const char *str, int len)
+{
+   if (session->outlen + len > OUTSIZE) return FALSE;
+   memcpy(session->out + session->outlen, str, len);
+   session->outlen += len;
+   return TRUE;
+}
+
+/* Forget what the client's terminal shows, so that it is cleared and everything is drawn again */
+static void invalidate(session_t *session)
+{
+   memset(session->screen, 0xff, sizeof(session->screen));
+   session->attr = session->x = session->y = -1;
+   session->clear = TRUE;
+}
+
+/* Put a string on the client's screen, sending only the characters that changed. Returns FALSE if the output is full */
+static bool put(session_t *session, int x, int y, int fg, int bg, int bold, const char *str)
+{
+   char seq[32];
+   int len,attr = fg | bg << 3 | (bold ? BOLD : 0);
+   for ( ; *str != '\0' && x < WIDTH; str++, x++)
+	 {
+		cell_t *cell = &session->screen[y][x];
+		if (cell->ch == (unsigned char) *str && cell->attr == attr) continue;
+		/* the longest a character can take is a cursor movement, a color and itself */
+		if (session->outlen + 2 * sizeof(seq) + 1 > OUTSIZE) return FALSE;
+		if (y != session->y || x != session->x)
+		  {
+			 if (y == session->y && x > session->x) len = snprintf(seq, sizeof(seq), "\033[%dC", x - session->x);
+			 else len = snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1);
+			 emit(session, seq, len);
+		  }
+		if (attr != session->attr)
+		  {
+			 /* black on black is the terminal's default colors, like in the ansi backend */
+			 if (fg == COLOR_BLACK && bg == COLOR_BLACK) len = snprintf(seq, sizeof(seq), "\033[0;%dm", bold ? 1 : 0);
+			 else len = snprintf(seq, sizeof(seq), "\033[0;%d;%d;%dm", bold ? 1 : 0, 30 + fg, 40 + bg);
+			 emit(session, seq, len);
+			 session->attr = attr;
+		  }
+		emit(session, str, 1);
+		cell->ch = *str;
+		cell->attr = attr;
+		session->x = x + 1;
+		session->y = y;
+	 }
+   return TRUE;
+}
+
+/* Put a line of text in the status panel (over all of the previous one) */
+static bool putline(session_t *session, int y, const char *str)
+{
+   char line[WIDTH - PANELX + 1];
+   snprintf(line, sizeof(line), "%-*s", WIDTH - PANELX, str);
+   return put(session, PANELX, y, COLOR_WHITE, COLOR_BLACK, FALSE, line);
+}
+
+/* Put a number in the status panel */
+static bool putvalue(session_t *session, int y, const char *label, int value)
+{
+   char str[WIDTH + 1];
+   snprintf(str, sizeof(str), "%-7s%d", label, value);
+   return putline(session, y, str);
+}
+
+/* Help shown in the status panel */
+static const char *help[] =
+{
+   "p: Pause      j: Left",
+   "k: Rotate     l: Right",
+   "s: Draw next  d: Lines",
+   "a: Speed up   q: Quit",
+   "SPACE: Drop",
+   NULL
+};
+
+/* Draw the game the way tint does (only the cells that changed are sent). Returns FALSE if the output is full */
+static bool draw(session_t *session)
+{
+   const game_t *game = &session->game;
+   const engine_t *engine = &game->engine;
+   board_t view;
+   char next[4][11];
+   int x,y,i,cell;
+   if (session->clear)
+	 {
+		if (!emit(session, "\033[0m\033[2J", 8)) return FALSE;
+		session->clear = FALSE;
+	 }
+   engine_view(engine, &view);
+   /* board */
+   for (y = 1; y < NUMROWS - 1; y++) for (x = 0; x < NUMCOLS - 1; x++)
+	 {
+		cell = view.color[y][x];
+		if (cell == WALL)
+		  {
+			 if (!put(session, x * 2, y - 1, COLOR_BLUE, COLOR_BLACK, TRUE, "<>")) return FALSE;
+		  }
+		else if (cell == COLOR_BLACK)
+		  {
+			 if (!put(session, x * 2, y - 1, COLOR_BLUE, COLOR_BLACK, FALSE, game->dottedlines ? ". " : "  ")) return FALSE;
+		  }
+		else if (!put(session, x * 2, y - 1, COLOR_BLACK, cell, FALSE, "  ")) return FALSE;
+	 }
+   /* status */
+   if (!putvalue(session, 1, "Level", game->level) ||
+	   !putvalue(session, 2, "Lines", engine->status.droppedlines) ||
+	   !putvalue(session, 3, "Score", GETSCORE(engine->score)) ||
+	   !putvalue(session, 4, "Shapes", game_shapes(game)))
+	 return FALSE;
+   if (!putline(session, 6, session->over ? "GAME OVER (q to quit)" : session->paused ? "PAUSED" : "")) return FALSE;
+   /* next shape */
+   memset(next, ' ', sizeof(next));
+   if (game->shownext)
+	 for (i = 0; i < NUMBLOCKS; i++)
+	   {
+		  x = SHAPES[engine->nextshape].orient[0].block[i].x + 2;
+		  y = SHAPES[engine->nextshape].orient[0].block[i].y + 1;
+		  if (x >= 0 && x < 5 && y >= 0 && y < 4) next[y][x * 2] = next[y][x * 2 + 1] = '#';
+	   }
+   if (!putline(session, 8, game->shownext ? "Next:" : "")) return FALSE;
+   for (y = 0; y < 4; y++) for (x = 0; x < 10; x += 2)
+	 if (!put(session, PANELX + 2 + x, 10 + y, COLOR_BLACK, next[y][x] == '#' ? SHAPES[engine->nextshape].color : COLOR_BLACK, FALSE, "  "))
+	   return FALSE;
+   /* help */
+   for (i = 0; help[i] != NULL; i++)
+	 if (!putline(session, 15 + i, help[i])) return FALSE;
+   return TRUE;
+}
+
+/*
+ * Sessions
+ */
+
+/* Watch for input (and for the socket to be writable if output is waiting) */
+static void watch(session_t *session, int op)
+{
+   struct epoll_event event;
+   event.events = EPOLLIN | (session->writing ? EPOLLOUT : 0);
+   event.data.ptr = session;
+   epoll_ctl(epfd, op, session->fd, &event);
+}
+
+/* The client is gone (the session is freed at the end of the loop) */
+static void disconnect(session_t *session)
+{
+   if (session->fd < 0) return;
+   unschedule(session);
+   epoll_ctl(epfd, EPOLL_CTL_DEL, session->fd, NULL);
+   close(session->fd);
+   session->fd = -1;
+   sessions--;
+   touch(session);
+}
+
+/* Write as much of the output as the socket takes */
+static void flush(session_t *session)
+{
+   int n,done = 0;
+   bool writing;
+   while (done < session->outlen)
+	 {
+		if ((n = send(session->fd, session->out + done, session->outlen - done, MSG_NOSIGNAL)) > 0) done += n;
+		else if (n < 0 && errno == EINTR) continue;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		else
+		  {
+			 disconnect(session);
+			 return;
+		  }
+	 }
+   memmove(session->out, session->out + done, session->outlen - done);
+   session->outlen -= done;
+   writing = session->outlen > 0;
+   if (writing == session->writing) return;
+   session->writing = writing;
+   watch(session, EPOLL_CTL_MOD);
+   /* the frame that didn't fit can be finished now */
+   if (!writing) touch(session);
+}
+
+/* Move the shape of a session down a row and set the time of the next row */
+static void gravity(session_t *session, int64_t t)
+{
+   if (game_gravity(&session->game) < 0)
+	 {
+		session->over = TRUE;
+		touch(session);
+		return;
+	 }
+   session->expires += DELAY(session->game.level);
+   /* don't try to catch up if we fell behind */
+   if (session->expires < t) session->expires = t + DELAY(session->game.level);
+   schedule(session);
+   touch(session);
+}
+
+/* Run the gravity of every session whose time has come */
+static void runtimers(int64_t t)
+{
+   session_t *session,*next;
+   int slot;
+   /* after a long stall, going round the wheel once is enough */
+   if (t - wheeltime > WHEELSIZE * RESOLUTION) wheeltime = t - t % RESOLUTION - WHEELSIZE * RESOLUTION;
+   while (wheeltime + RESOLUTION <= t)
+	 {
+		slot = (wheeltime / RESOLUTION) % WHEELSIZE;
+		for (session = wheel[slot]; session != NULL; session = next)
+		  {
+			 next = session->next;
+			 if (session->expires >= wheeltime + RESOLUTION) continue;
+			 unschedule(session);
+			 gravity(session, t);
+		  }
+		wheeltime += RESOLUTION;
+	 }
+}
+
+/* Do what the player asked for */
+static void key(session_t *session, int ch, int64_t t)
+{
+   static const struct { int ch,event; } keys[] =
+	 {
+		{ 'j', REPLAY_LEFT }, { 'k', REPLAY_ROTATE }, { 'l', REPLAY_RIGHT }, { ' ', REPLAY_DROP },
+		{ 's', REPLAY_SHOWNEXT }, { 'd', REPLAY_DOTTED }, { 'a', REPLAY_LEVELUP }, { 0, 0 }
+	 };
+   int i;
+   switch (ch)
+	 {
+	  case 'q':
+		disconnect(session);
+		return;
+		/* redraw (the client sends it when its terminal changed size) */
+	  case '\f':
+		invalidate(session);
+		break;
+	  case 'p':
+		if (session->over) return;
+		session->paused = !session->paused;
+		if (session->paused) unschedule(session);
+		else
+		  {
+			 session->expires = t + DELAY(session->game.level);
+			 schedule(session);
+		  }
+		break;
+	  default:
+		if (session->over || session->paused) return;
+		for (i = 0; keys[i].ch && keys[i].ch != ch; i++) ;
+		if (!keys[i].ch || !game_event(&session->game, keys[i].event)) emit(session, "\a", 1);
+	 }
+   touch(session);
+}
+
+/* Handle the keys the client sent */
+static void input(session_t *session, int64_t t)
+{
+   unsigned char buf[KEYSIZE];
+   int i,n;
+   if ((n = read(session->fd, buf, sizeof(buf))) <= 0)
+	 {
+		if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) disconnect(session);
+		return;
+	 }
+   for (i = 0; i < n && session->fd >= 0; i++) key(session, buf[i], t);
+}
+
+/* Start a game for a new client */
+static void connected(int fd, int64_t t)
+{
+   static uint64_t count;
+   session_t *session;
+   if (sessions >= maxsessions || (session = malloc(sizeof(session_t))) == NULL)
+	 {
+		send(fd, "The server is full\r\n", 20, MSG_NOSIGNAL | MSG_DONTWAIT);
+		close(fd);
+		return;
+	 }
+   session->fd = fd;
+   session->game.level = startlevel;
+   session->game.shownext = session->game.dottedlines = FALSE;
+   session->game.replay = NULL;
+   session->game.scorefile = NULL;
+   game_init(&session->game, time(NULL) ^ (++count * 0x9e3779b97f4a7c15ULL));
+   session->paused = session->over = FALSE;
+   session->dirty = session->writing = FALSE;
+   session->slot = -1;
+   session->expires = t + DELAY(startlevel);
+   schedule(session);
+   invalidate(session);
+   watch(session, EPOLL_CTL_ADD);
+   sessions++;
+   touch(session);
+}
+
+/* Accept every client that is waiting */
+static void accept_clients(int64_t t)
+{
+   int fd;
+   for (;;)
+	 {
+		if ((fd = accept(listenfd, NULL, NULL)) < 0)
+		  {
+			 if (errno == EINTR || errno == ECONNABORTED) continue;
+			 if ((errno != EMFILE && errno != ENFILE) || sparefd < 0) return;
+			 /*
+			  * Out of descriptors: the client would stay in the backlog and
+			  * wake us up again straight away (the listening socket is level
+			  * triggered), so use the spare to take it & turn it away.
+			  */
+			 close(sparefd);
+			 if ((fd = accept(listenfd, NULL, NULL)) >= 0)
+			   {
+				  send(fd, "The server is full\r\n", 20, MSG_NOSIGNAL | MSG_DONTWAIT);
+				  close(fd);
+			   }
+			 sparefd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+			 if (fd < 0) return;
+			 continue;
+		  }
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		connected(fd, t);
+	 }
+}
+
+/* Draw the sessions that changed and free the ones that are gone */
+static void drawsessions()
+{
+   session_t *session;
+   bool done;
+   while ((session = dirty) != NULL)
+	 {
+		dirty = session->nextdirty;
+		session->dirty = FALSE;
+		if (session->fd < 0)
+		  {
+			 free(session);
+			 continue;
+		  }
+		/* wait for the client to take what it has before drawing more */
+		if (session->writing) continue;
+		done = draw(session);
+		flush(session);
+		/* flush() may have found the client gone (and put it back on the list) */
+		if (session->fd < 0) continue;
+		/* the rest of the frame goes as soon as the socket has taken this part (right away if it took all of it) */
+		if (!done && !session->writing) touch(session);
+	 }
+}
+
+/*
+ * Setup
+ */
+
+static void showhelp()
+{
+   fprintf(stderr, "USAGE: tint-server [-h] [-s socket] [-n sessions] [-l level]\n");
+   fprintf(stderr, "  -h             Show this help message\n");
+   fprintf(stderr, "  -s <socket>    Unix domain socket to listen on (default %s)\n", DEFAULTSOCKET);
+   fprintf(stderr, "  -n <sessions>  Most games at the same time (default %d)\n", DEFAULTSESSIONS);
+   fprintf(stderr, "  -l <level>     Level every game starts at (%d-%d)\n", MINLEVEL, MAXLEVEL);
+   fprintf(stderr, "\nPlayers connect with tint-client.\n");
+   exit(EXIT_FAILURE);
+}
+
+static void parse_options(int argc, char *argv[])
+{
+   int i = 1;
+   while (i < argc)
+	 {
+		if (strcmp(argv[i], "-h") == 0) showhelp();
+		if (i + 1 >= argc) showhelp();
+		if (strcmp(argv[i], "-s") == 0)
+		  socketfile = argv[++i];
+		else if (strcmp(argv[i], "-n") == 0)
+		  {
+			 if (!strtoint(&maxsessions, argv[++i]) || maxsessions < 1) showhelp();
+		  }
+		else if (strcmp(argv[i], "-l") == 0)
+		  {
+			 if (!strtoint(&startlevel, argv[++i]) || startlevel < MINLEVEL || startlevel > MAXLEVEL) showhelp();
+		  }
+		else
+		  {
+			 fprintf(stderr, "Invalid option -- %s\n", argv[i]);
+			 showhelp();
+		  }
+		i++;
+	 }
+}
+
+static void stop(int sig)
+{
+   finished = TRUE;
+}
+
+/* Remove a socket left behind by a server that is gone. Returns OK, or ERR if the path is something else or a server is still listening on it */
+static int removestale(const struct sockaddr_un *addr)
+{
+   struct stat st;
+   int fd,result;
+   if (lstat(socketfile, &st) < 0) return errno == ENOENT ? OK : ERR;
+   if (!S_ISSOCK(st.st_mode))
+	 {
+		errno = EEXIST;
+		return ERR;
+	 }
+   if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return ERR;
+   result = connect(fd, (const struct sockaddr *) addr, sizeof(*addr));
+   close(fd);
+   if (result == 0)
+	 {
+		errno = EADDRINUSE;
+		return ERR;
+	 }
+   if (errno != ECONNREFUSED) return ERR;
+   return unlink(socketfile) < 0 ? ERR : OK;
+}
+
+/* Listen on the socket. Returns OK or ERR */
+static int listen_socket()
+{
+   struct sockaddr_un addr;
+   struct epoll_event event;
+   if (strlen(socketfile) >= sizeof(addr.sun_path))
+	 {
+		errno = ENAMETOOLONG;
+		return ERR;
+	 }
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, socketfile);
+   if ((sparefd = open("/dev/null", O_RDONLY | O_CLOEXEC)) < 0 ||
+	   removestale(&addr) != OK ||
+	   (listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+	   bind(listenfd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	   listen(listenfd, SOMAXCONN) < 0 ||
+	   (epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+	 return ERR;
+   event.events = EPOLLIN;
+   event.data.ptr = NULL;
+   return epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &event) < 0 ? ERR : OK;
+}
+
+/* Make sure there are enough descriptors for every session, or have fewer sessions */
+static void limit_sessions()
+{
+   struct rlimit rl;
+   rlim_t needed = (rlim_t) maxsessions + RESERVEDFDS;
+   if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= needed) return;
+   /* raise the limit as far as we are allowed to */
+   if (rl.rlim_max == RLIM_INFINITY || rl.rlim_max > needed) rl.rlim_cur = needed;
+   else rl.rlim_cur = rl.rlim_max;
+   setrlimit(RLIMIT_NOFILE, &rl);
+   if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur >= needed) return;
+   if (rl.rlim_cur <= RESERVEDFDS)
+	 {
+		fprintf(stderr, "Not enough file descriptors (%lu)\n", (unsigned long) rl.rlim_cur);
+		exit(EXIT_FAILURE);
+	 }
+   maxsessions = rl.rlim_cur - RESERVEDFDS;
+   fprintf(stderr, "Only %d games at the same time (there aren't enough file descriptors)\n", maxsessions);
+}
+
+int main(int argc, char *argv[])
+{
+   struct epoll_event events[MAXEVENTS];
+   struct sigaction sa;
+   session_t *session;
+   int64_t t;
+   int i,n;
+   parse_options(argc, argv);
+   limit_sessions();
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = stop;
+   sigaction(SIGINT, &sa, NULL);
+   sigaction(SIGTERM, &sa, NULL);
+   signal(SIGPIPE, SIG_IGN);
+   if (listen_socket() != OK)
+	 {
+		fprintf(stderr, "Can't listen on %s: %s\n", socketfile, strerror(errno));
+		exit(EXIT_FAILURE);
+	 }
+   t = now();
+   wheeltime = t - t % RESOLUTION;
+   while (!finished)
+	 {
+		n = epoll_wait(epfd, events, MAXEVENTS, nexttimeout(now()));
+		if (n < 0 && errno != EINTR)
+		  {
+			 fprintf(stderr, "epoll_wait: %s\n", strerror(errno));
+			 break;
+		  }
+		t = now();
+		for (i = 0; i < n; i++)
+		  {
+			 if ((session = events[i].data.ptr) == NULL)
+			   {
+				  accept_clients(t);
+				  continue;
+			   }
+			 if (session->fd < 0) continue;
+			 if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) input(session, t);
+			 if (session->fd >= 0 && (events[i].events & EPOLLOUT)) flush(session);
+		  }
+		runtimers(t);
+		drawsessions();
+	 }
+   close(listenfd);
+   unlink(socketfile);
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,510 @@
+
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Batch game simulator: plays lots of complete games on all the cores
+ * using one of the built-in policies, without any terminal I/O. It can
+ * also check a recorded game on all the cores, one stretch between two
+ * keyframes on each.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "typedefs.h"
+#include "engine.h"
+#include "replay.h"
+#include "game.h"
+
+/*
+ * Macros
+ */
+
+/* Number of games a worker takes from the queue at a time */
+#define CHUNK 16
+
+/* Maximum number of worker threads */
+#define MAXTHREADS 256
+
+/*
+ * Type definitions
+ */
+
+/* A game in progress and the policy playing it */
+typedef struct
+{
+   game_t game;
+   uint64_t rand;		/* random number generator state of the policy */
+} player_t;
+
+/* Called whenever a new shape is released, before gravity moves it */
+typedef void (*policy_t)(player_t *player);
+
+typedef struct
+{
+   int lines;
+   int score;
+} result_t;
+
+typedef struct
+{
+   pthread_t thread;
+   unsigned long pieces;
+   uint64_t ticks;
+   uint64_t calls[NUMPROFILES],cycles[NUMPROFILES];	/* engine profile (see engine_profile()) */
+} worker_t;
+
+/* Result of checking a stretch of a replay */
+typedef enum { SEGMENT_OK, SEGMENT_DIFFERENT, SEGMENT_DAMAGED } segment_t;
+
+/*
+ * Global variables
+ */
+
+static int games = 1000;
+static int threads = 0;
+static int startlevel = MINLEVEL;
+static int maxpieces = 10000;
+static uint64_t firstseed = 1;
+static policy_t policy;
+static const char *verifyfile;
+
+/* Number of stretches of the replay to check (one more than the keyframes) */
+static int segments;
+
+/* Next stretch to be checked */
+static atomic_int nextsegment;
+
+/* Results of each stretch & the tick at which it ended */
+static segment_t *verified;
+static uint64_t *endtick;
+
+/* Next game to be played */
+static atomic_int nextgame;
+
+/* Results of each game */
+static result_t *results;
+
+/*
+ * Functions
+ */
+
+/* Convert a string to integer. Returns TRUE if successful, FALSE otherwise. */
+static bool strtoint(int *i, const char *str)
+{
+   char *endptr;
+   long val = strtol(str, &endptr, 0);
+   if (*str == '\0' || *endptr != '\0' || val == LONG_MIN || val == LONG_MAX || val < INT_MIN || val > INT_MAX) return FALSE;
+   *i = (int)val;
+   return TRUE;
+}
+
+/* Random number within range for the policies (xorshift64) */
+static int policy_rand(player_t *player, int range)
+{
+   player->rand ^= player->rand << 13;
+   player->rand ^= player->rand >> 7;
+   player->rand ^= player->rand << 17;
+   return ((int) ((player->rand >> 32) % range));
+}
+
+/* Rotate the shape and move it to a column, both chosen at random */
+static void place_random(player_t *player)
+{
+   engine_t *engine = &player->game.engine;
+   int i,x = 1 + policy_rand(player, NUMCOLS - 3);
+   for (i = policy_rand(player, NUMORIENTS); i > 0; i--) engine_move(engine, ACTION_ROTATE);
+   for (i = 0; i < NUMCOLS && engine->curx < x; i++) engine_move(engine, ACTION_RIGHT);
+   for (i = 0; i < NUMCOLS && engine->curx > x; i++) engine_move(engine, ACTION_LEFT);
+}
+
+/* Drop the shape where it is released */
+static void policy_drop(player_t *player)
+{
+   engine_move(&player->game.engine, ACTION_DROP);
+}
+
+/* Drop the shape at a random position */
+static void policy_random(player_t *player)
+{
+   place_random(player);
+   engine_move(&player->game.engine, ACTION_DROP);
+}
+
+/* Let gravity take the shape down from a random position */
+static void policy_gravity(player_t *player)
+{
+   place_random(player);
+}
+
+/* Rate a board: lines cleared are good, high, holey and bumpy stacks are bad */
+static int rate(const engine_t *engine, int lines)
+{
+   const unsigned char *height = engine_heights(engine);
+   int x,y,holes = 0,aggregate = 0,bumpiness = 0;
+   for (x = 1; x < NUMCOLS - 2; x++)
+	 {
+		aggregate += height[x];
+		if (x > 1) bumpiness += abs(height[x] - height[x - 1]);
+		for (y = NUMROWS - 2 - height[x]; y < NUMROWS - 2; y++)
+		  if (!(engine->board.row[y] & (1 << x))) holes++;
+	 }
+   return 76 * lines - 51 * aggregate - 36 * holes - 18 * bumpiness;
+}
+
+/* Try every placement of the shape and follow the path to the best one */
+static void policy_greedy(player_t *player)
+{
+   static __thread placements_t placements;
+   action_t path[NUMSTATES];
+   engine_t *engine = &player->game.engine,test;
+   int i,n,rating,best = -1,bestrating = INT_MIN;
+   n = engine_enumerate_placements(engine, &placements);
+   for (i = 0; i < n; i++)
+	 {
+		/* only the engine is tried, so the score function still sees the real game */
+		test = *engine;
+		test.curx = placements.placement[i].x;
+		test.cury = placements.placement[i].y;
+		test.curorient = placements.placement[i].orient;
+		if (engine_evaluate(&test) < 0) continue;
+		rating = rate(&test, test.status.droppedlines - engine->status.droppedlines);
+		if (rating > bestrating)
+		  {
+			 bestrating = rating;
+			 best = i;
+		  }
+	 }
+   if (best < 0) return;
+   n = engine_placement_path(&placements, &placements.placement[best], path);
+   for (i = 0; i < n; i++) engine_move(engine, path[i]);
+}
+
+static const struct
+{
+   const char *name;
+   policy_t policy;
+   const char *description;
+} policies[] =
+{
+   { "drop",    policy_drop,    "drop every shape where it is released" },
+   { "random",  policy_random,  "drop every shape at a random position" },
+   { "gravity", policy_gravity, "let gravity take every shape down from a random position" },
+   { "greedy",  policy_greedy,  "move every shape to the best placement for the next lock" },
+   { NULL, NULL, NULL }
+};
+
+/* Play one game, returns the number of pieces played */
+static unsigned long play(int n)
+{
+   player_t player;
+   game_t *game = &player.game;
+   int pieces = 1,status = 0;
+   game->level = startlevel;
+   game->shownext = game->dottedlines = FALSE;
+   game->replay = NULL;
+   game_init(game, firstseed + n);
+   player.rand = (firstseed + n) * 0x9e3779b97f4a7c15ULL | 1;
+   policy(&player);
+   while (status >= 0 && pieces < maxpieces)
+	 {
+		status = game_gravity(game);
+		if (status == 0)
+		  {
+			 pieces++;
+			 policy(&player);
+		  }
+	 }
+   results[n].lines = game->engine.status.droppedlines;
+   results[n].score = GETSCORE(game->engine.score);
+   return pieces;
+}
+
+/* Keep the engine profile of the thread before it goes away */
+static void getprofile(worker_t *self)
+{
+   int i;
+   for (i = 0; engine_profile(i, &self->calls[i], &self->cycles[i]) != NULL; i++) ;
+}
+
+/* Play games until there are none left */
+static void *worker(void *arg)
+{
+   worker_t *self = arg;
+   int i,n;
+   while ((n = atomic_fetch_add(&nextgame, CHUNK)) < games)
+	 for (i = n; i < n + CHUNK && i < games; i++) self->pieces += play(i);
+   getprofile(self);
+   return NULL;
+}
+
+/* Play stretch n of a replay (from keyframe n - 1, or the start, to keyframe n, or the end) the way tint does */
+static segment_t verify(replay_t *replay, int n, uint64_t *ticks)
+{
+   game_t game;
+   keyframe_t keyframe;
+   int event,status = 0;
+   uint64_t tick;
+   *ticks = n ? replay->index[n - 1].tick : 0;
+   if (replay_seek(replay, n - 1) != OK) return SEGMENT_DAMAGED;
+   game.level = replay->level;
+   game.shownext = (replay->flags & REPLAY_FLAG_SHOWNEXT) != 0;
+   game.dottedlines = (replay->flags & REPLAY_FLAG_DOTTED) != 0;
+   game.replay = NULL;
+   game_init(&game, replay->seed);
+   if (n && game_restore(&game, &replay->keyframe) != OK) return SEGMENT_DAMAGED;
+   while (replay_read(replay, &tick, &event) == OK)
+	 {
+		/* gravity (the same as in tint) */
+		while (status >= 0 && game.ticks < tick) status = game_gravity(&game);
+		*ticks = game.ticks;
+		if (event == REPLAY_KEYFRAME)
+		  {
+			 game_keyframe(&game, &keyframe);
+			 if (status < 0 || replay_compare(&keyframe, &replay->keyframe) != 0) return SEGMENT_DIFFERENT;
+			 /* the stretch ends at the next keyframe in the index (there is no index if the recording is incomplete) */
+			 if (n < replay->keyframes) return SEGMENT_OK;
+			 continue;
+		  }
+		if (event == REPLAY_END)
+		  return *ticks == tick && replay->score == GETSCORE(game.engine.score) &&
+			replay->lines == game.engine.status.droppedlines ? SEGMENT_OK : SEGMENT_DIFFERENT;
+		/* tint ignores the player once the game is over */
+		if (status < 0) continue;
+		game_event(&game, event);
+	 }
+   return SEGMENT_DAMAGED;
+}
+
+/* Check stretches of the replay until there are none left */
+static void *verifier(void *arg)
+{
+   worker_t *self = arg;
+   replay_t replay;
+   int n;
+   if (replay_open(&replay, verifyfile) != OK) return NULL;
+   while ((n = atomic_fetch_add(&nextsegment, 1)) < segments)
+	 {
+		verified[n] = verify(&replay, n, &endtick[n]);
+		self->ticks += endtick[n] - (n ? replay.index[n - 1].tick : 0);
+	 }
+   replay_close(&replay);
+   getprofile(self);
+   return NULL;
+}
+
+static int cmpint(const void *a, const void *b)
+{
+   return (*(const int *) a > *(const int *) b) - (*(const int *) a < *(const int *) b);
+}
+
+/* Show the distribution of one of the results */
+static void distribution(const char *name, size_t offset)
+{
+   int i,*value = malloc(games * sizeof(int));
+   double sum = 0;
+   if (value == NULL)
+	 {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	 }
+   for (i = 0; i < games; i++) sum += value[i] = *(int *) ((char *) &results[i] + offset);
+   qsort(value, games, sizeof(int), cmpint);
+   /* games * 99 doesn't fit in an int past about 21 million games */
+   printf("%-12s min %d p10 %d p50 %d p90 %d p99 %d max %d mean %.2f\n", name,
+		  value[0], value[games / 10], value[games / 2], value[(int64_t) games * 9 / 10], value[(int64_t) games * 99 / 100], value[games - 1], sum / games);
+   free(value);
+}
+
+static void showhelp()
+{
+   int i;
+   fprintf(stderr, "USAGE: tint-sim [-h] [-g games] [-j threads] [-p policy] [-l level] [-m pieces] [-s seed] [-v replay]\n");
+   fprintf(stderr, "  -h           Show this help message\n");
+   fprintf(stderr, "  -g <games>   Number of games to play (default %d)\n", games);
+   fprintf(stderr, "  -j <threads> Number of threads (default one per core)\n");
+   fprintf(stderr, "  -p <policy>  How the shapes are played (default %s)\n", policies[0].name);
+   fprintf(stderr, "  -l <level>   Level to play at (%d-%d)\n", MINLEVEL, MAXLEVEL);
+   fprintf(stderr, "  -m <pieces>  Stop a game after this many pieces (default %d)\n", maxpieces);
+   fprintf(stderr, "  -s <seed>    Seed of the first game, game n uses seed + n (default %d)\n", (int) firstseed);
+   fprintf(stderr, "  -v <replay>  Check that a recorded game plays back the same instead\n");
+   fprintf(stderr, "\nPolicies:\n");
+   for (i = 0; policies[i].name != NULL; i++) fprintf(stderr, "  %-12s %s\n", policies[i].name, policies[i].description);
+   exit(EXIT_FAILURE);
+}
+
+static void parse_options(int argc, char *argv[])
+{
+   int i = 1,j,seed;
+   policy = policies[0].policy;
+   while (i < argc)
+	 {
+		if (strcmp(argv[i], "-h") == 0) showhelp();
+		if (i + 1 >= argc) showhelp();
+		if (strcmp(argv[i], "-g") == 0)
+		  {
+			 if (!strtoint(&games, argv[++i]) || games < 1) showhelp();
+		  }
+		else if (strcmp(argv[i], "-j") == 0)
+		  {
+			 if (!strtoint(&threads, argv[++i]) || threads < 1 || threads > MAXTHREADS) showhelp();
+		  }
+		else if (strcmp(argv[i], "-l") == 0)
+		  {
+			 if (!strtoint(&startlevel, argv[++i]) || startlevel < MINLEVEL || startlevel > MAXLEVEL) showhelp();
+		  }
+		else if (strcmp(argv[i], "-m") == 0)
+		  {
+			 if (!strtoint(&maxpieces, argv[++i]) || maxpieces < 1) showhelp();
+		  }
+		else if (strcmp(argv[i], "-s") == 0)
+		  {
+			 if (!strtoint(&seed, argv[++i])) showhelp();
+			 firstseed = (uint64_t) seed;
+		  }
+		else if (strcmp(argv[i], "-v") == 0)
+		  verifyfile = argv[++i];
+		else if (strcmp(argv[i], "-p") == 0)
+		  {
+			 i++;
+			 for (j = 0; policies[j].name != NULL && strcmp(policies[j].name, argv[i]) != 0; j++) ;
+			 if (policies[j].name == NULL)
+			   {
+				  fprintf(stderr, "Unknown policy -- %s\n", argv[i]);
+				  showhelp();
+			   }
+			 policy = policies[j].policy;
+		  }
+		else
+		  {
+			 fprintf(stderr, "Invalid option -- %s\n", argv[i]);
+			 showhelp();
+		  }
+		i++;
+	 }
+}
+
+/* Start the threads and wait for them to finish. Returns the time it took */
+static double run(worker_t *workers, void *(*function)(void *))
+{
+   struct timespec start,end;
+   int i;
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for (i = 0; i < threads; i++)
+	 if (pthread_create(&workers[i].thread, NULL, function, &workers[i]) != 0)
+	   {
+		  fprintf(stderr, "Unable to create thread\n");
+		  exit(EXIT_FAILURE);
+	   }
+   for (i = 0; i < threads; i++) pthread_join(workers[i].thread, NULL);
+   clock_gettime(CLOCK_MONOTONIC, &end);
+   return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/* Show where the engine spent its time on all the threads (only if it was built with -DENGINE_PROFILE) */
+static void showprofile(const worker_t *workers)
+{
+   const char *name;
+   uint64_t calls,cycles;
+   int i,j;
+   for (i = 0; (name = engine_profile(i, &calls, &cycles)) != NULL; i++)
+	 {
+		for (j = 0; j < threads; j++)
+		  {
+			 calls += workers[j].calls[i];
+			 cycles += workers[j].cycles[i];
+		  }
+		printf("%-12s %-14s calls %llu cycles %llu cycles/call %.1f\n", "profile", name,
+			   (unsigned long long) calls, (unsigned long long) cycles, calls ? (double) cycles / calls : 0.0);
+	 }
+}
+
+/* Check a recorded game and exit */
+static void verifyreplay(worker_t *workers)
+{
+   static const char *failure[] = { "ok", "does not match the recording", "is damaged" };
+   replay_t replay;
+   uint64_t ticks = 0;
+   double seconds;
+   int i,failed = 0;
+   if (replay_open(&replay, verifyfile) != OK || replay.level < MINLEVEL || replay.level > MAXLEVEL)
+	 {
+		fprintf(stderr, "%s is not a tint replay\n", verifyfile);
+		exit(EXIT_FAILURE);
+	 }
+   segments = replay.keyframes + 1;
+   if ((verified = calloc(segments, sizeof(segment_t))) == NULL || (endtick = calloc(segments, sizeof(uint64_t))) == NULL)
+	 {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	 }
+   for (i = 0; i < segments; i++) verified[i] = SEGMENT_DAMAGED;
+   seconds = run(workers, verifier);
+   for (i = 0; i < threads; i++) ticks += workers[i].ticks;
+   for (i = 0; i < segments; i++)
+	 if (verified[i] != SEGMENT_OK)
+	   {
+		  fprintf(stderr, "%s: ticks %llu to %llu %s\n", verifyfile,
+				  (unsigned long long) (i ? replay.index[i - 1].tick : 0), (unsigned long long) endtick[i], failure[verified[i]]);
+		  failed++;
+	   }
+   printf("%-12s %s\n", "replay", verifyfile);
+   printf("%-12s %d\n", "threads", threads);
+   printf("%-12s %d\n", "segments", segments);
+   printf("%-12s %d\n", "failed", failed);
+   printf("%-12s %llu\n", "ticks", (unsigned long long) ticks);
+   printf("%-12s %.3f\n", "seconds", seconds);
+   printf("%-12s %.0f\n", "ticks/sec", ticks / seconds);
+   showprofile(workers);
+   replay_close(&replay);
+   free(verified);
+   free(endtick);
+   exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+   static worker_t workers[MAXTHREADS];
+   unsigned long pieces = 0;
+   double seconds;
+   int i;
+   parse_options(argc, argv);
+   if (!threads)
+	 {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (threads < 1) threads = 1;
+		if (threads > MAXTHREADS) threads = MAXTHREADS;
+	 }
+   if (verifyfile != NULL) verifyreplay(workers);
+   if ((results = calloc(games, sizeof(result_t))) == NULL)
+	 {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	 }
+   seconds = run(workers, worker);
+   for (i = 0; i < threads; i++) pieces += workers[i].pieces;
+   printf("%-12s %d\n", "games", games);
+   printf("%-12s %d\n", "threads", threads);
+   printf("%-12s %lu\n", "pieces", pieces);
+   printf("%-12s %.3f\n", "seconds", seconds);
+   printf("%-12s %.0f\n", "games/sec", games / seconds);
+   printf("%-12s %.0f\n", "pieces/sec", pieces / seconds);
+   distribution("lines", offsetof(result_t, lines));
+   distribution("score", offsetof(result_t, score));
+   showprofile(workers);
+   free(results);
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,432 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Checks of the engine (make check). Boards are set up with
+ * engine_restore() and the results are compared with the slow and obvious
+ * way of getting them: rows cleared one at a time, shapes moved down a row
+ * at a time and every position tried with engine_move().
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "typedefs.h"
+#include "engine.h"
+
+/* Number of random games (and shapes in each) to check the placements & snapshots with */
+#define GAMES	20
+#define PIECES	60
+
+/* A shape position (the index of placements_t) */
+#define STATE(x,y,orient) ((((orient) * NUMROWS) + (y)) * NUMCOLS + (x))
+
+/* The vertical I shape (its blocks are in one column, from one row above to two rows below the centre) */
+#define ISHAPE	6
+#define IVERTICAL	1
+
+static void scored(engine_t *engine, void *userdata)
+{
+   engine->score++;
+}
+
+/* Random numbers for the moves (not the engine's, so that they don't change the game) */
+static unsigned int random_value(uint64_t *state, unsigned int range)
+{
+   *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+   return (unsigned int) (*state >> 33) % range;
+}
+
+/*
+ * Setting up boards
+ */
+
+/* Put a picture of the bottom of the board in the rows ('#' = block, one character per column) */
+static void picture(row_t *row, const char *const *lines)
+{
+   int i,x,y,n;
+   for (n = 0; lines[n] != NULL; n++) ;
+   for (y = 0; y < NUMROWS - 2; y++) row[y] = WALLROW;
+   for (i = 0; i < n; i++)
+	 for (x = 0; x < NUMCOLS - 3; x++)
+	   if (lines[i][x] == '#') row[NUMROWS - 2 - n + i] |= 1 << (x + 1);
+}
+
+/* Work out the heights of the columns from the rows */
+static void heights(snapshot_t *snapshot)
+{
+   int x,y;
+   for (x = 1; x < NUMCOLS - 2; x++)
+	 {
+		for (y = 0; y < NUMROWS - 2 && !(snapshot->row[y] & (1 << x)); y++) ;
+		snapshot->height[x - 1] = NUMROWS - 2 - y;
+	 }
+}
+
+/* Start an engine with a board and the current shape where we want it. Returns OK or ERR */
+static int setup(engine_t *engine, const char *const *lines, int shape, int orient, int x, int y)
+{
+   snapshot_t snapshot;
+   engine_init(engine, scored, NULL, 1);
+   engine_snapshot(engine, &snapshot);
+   picture(snapshot.row, lines);
+   heights(&snapshot);
+   snapshot.curshape = shape;
+   snapshot.curorient = orient;
+   snapshot.curx = x;
+   snapshot.cury = y;
+   return engine_restore(engine, &snapshot);
+}
+
+/* Compare two snapshots (they aren't packed, so not with memcmp()). Returns TRUE if they are the same */
+static bool same(const snapshot_t *a, const snapshot_t *b)
+{
+   return a->seed == b->seed && a->score == b->score &&
+	 !memcmp(&a->status, &b->status, sizeof(status_t)) &&
+	 !memcmp(a->row, b->row, sizeof(a->row)) &&
+	 !memcmp(a->height, b->height, sizeof(a->height)) &&
+	 a->curx == b->curx && a->cury == b->cury &&
+	 a->curshape == b->curshape && a->nextshape == b->nextshape && a->curorient == b->curorient;
+}
+
+/*
+ * Line clears
+ */
+
+/* Bottom rows of the board & the number of lines a vertical I dropped in the last column clears */
+static const struct
+{
+   const char *lines[7];
+   int cleared;
+} clears[] =
+{
+   { { "#.#.#.#.#.", ".#.#.#.#..", "########..", "########..", "########..", "########..", NULL }, 0 },
+   { { "#.#.#.#.#.", ".#.#.#.#..", "########..", "########..", "########..", "#########.", NULL }, 1 },
+   { { "#.#.#.#.#.", ".#.#.#.#..", "#########.", "########..", "########..", "########..", NULL }, 1 },
+   { { "#.#.#.#.#.", ".#.#.#.#..", "#########.", "########..", "#########.", "########..", NULL }, 2 },
+   { { "#.#.#.#.#.", ".#.#.#.#..", "#########.", "#########.", ".########.", "#########.", NULL }, 3 },
+   { { "#.#.#.#.#.", ".#.#.#.#..", "#########.", "#########.", "#########.", "#########.", NULL }, 4 }
+};
+
+/* Drop a vertical I into the last column & compare the board with the rows cleared one at a time */
+static bool lineclear(int n)
+{
+   engine_t engine;
+   snapshot_t snapshot;
+   row_t row[NUMROWS - 2];
+   int i,y,lines = 0;
+   if (setup(&engine, clears[n].lines, ISHAPE, IVERTICAL, NUMCOLS - 3, 1) != OK) return FALSE;
+   engine_move(&engine, ACTION_DROP);
+   if (engine_evaluate(&engine) != 0) return FALSE;
+   /* the I fills the bottom four rows of the last column, then each full row goes & the ones above come down */
+   picture(row, clears[n].lines);
+   for (i = 1; i <= NUMBLOCKS; i++) row[NUMROWS - 2 - i] |= 1 << (NUMCOLS - 3);
+   for (y = NUMROWS - 3; y >= 0; y--)
+	 while (row[y] == FULLROW)
+	   {
+		  memmove(row + 1, row, y * sizeof(row_t));
+		  row[0] = WALLROW;
+		  lines++;
+	   }
+   engine_snapshot(&engine, &snapshot);
+   return lines == clears[n].cleared && engine.status.droppedlines == lines &&
+	 !memcmp(snapshot.row, row, sizeof(row)) && engine_check(&snapshot);
+}
+
+/*
+ * Drops
+ */
+
+/* A roof over columns 4-6 with room under it */
+static const char *roof[] = { "...###....", "..........", "..........", "..........", NULL };
+
+/* Drop the current shape & see if it lands on row y, like it does when it is moved down a row at a time */
+static bool dropsto(engine_t *engine, int y)
+{
+   engine_t slow = *engine;
+   int rows;
+   do
+	 {
+		rows = slow.cury;
+		engine_move(&slow, ACTION_DOWN);
+	 }
+   while (slow.cury != rows);
+   engine_move(engine, ACTION_DROP);
+   return engine->cury == y && slow.cury == y;
+}
+
+/* Square (shape 3, blocks one row above & one column left of the centre) under, beside and on the roof */
+static bool overhang(int n)
+{
+   static const struct { int x,y,to; } drops[] =
+	 {
+		{ 5, NUMROWS - 4, NUMROWS - 3 },		/* under the roof */
+		{ 4, NUMROWS - 4, NUMROWS - 3 },		/* one column under the roof */
+		{ 8, NUMROWS - 4, NUMROWS - 3 },		/* beside it */
+		{ 5, 1, NUMROWS - 7 },					/* on it */
+		{ 4, 1, NUMROWS - 7 }					/* half on it */
+	 };
+   engine_t engine;
+   int i,start;
+   for (i = 0; i < sizeof(drops) / sizeof(drops[0]); i++)
+	 {
+		if (setup(&engine, roof, 3, 0, drops[i].x, drops[i].y) != OK) return FALSE;
+		start = engine.cury;
+		if (!dropsto(&engine, drops[i].to) || engine.status.dropcount != drops[i].to - start) return FALSE;
+	 }
+   return TRUE;
+}
+
+/* ACTION_DOWN on a shape that is resting doesn't lock it */
+static bool down(int n)
+{
+   engine_t engine;
+   snapshot_t before,after;
+   if (setup(&engine, roof, 3, 0, 5, NUMROWS - 3) != OK) return FALSE;
+   engine_snapshot(&engine, &before);
+   engine_move(&engine, ACTION_DOWN);
+   engine_snapshot(&engine, &after);
+   return same(&before, &after);
+}
+
+/*
+ * Placements
+ */
+
+/* Put the current shape in a state */
+static void position(engine_t *engine, int state)
+{
+   engine->curx = state % NUMCOLS;
+   engine->cury = state / NUMCOLS % NUMROWS;
+   engine->curorient = state / (NUMCOLS * NUMROWS);
+}
+
+/* Can't the current shape move down? */
+static bool resting(const engine_t *engine)
+{
+   engine_t copy = *engine;
+   engine_move(&copy, ACTION_DOWN);
+   return copy.cury == engine->cury;
+}
+
+/*
+ * Try every action from every state reachable with engine_move() and
+ * compare the states where the shape comes to rest (and how many actions
+ * it takes to get there) with the placements. Also follow the path to
+ * each placement, and check that a drop goes where moving down does.
+ */
+static bool placements_match(const engine_t *engine, const placements_t *placements)
+{
+   static short queue[NUMSTATES],depth[NUMSTATES];
+   static bool placed[NUMSTATES];
+   engine_t copy,slow;
+   action_t path[NUMSTATES];
+   int head = 0,tail = 0,state,next,action,i,rests = 0,rows;
+   memset(depth, 0xff, sizeof(depth));
+   memset(placed, 0, sizeof(placed));
+   state = STATE(engine->curx, engine->cury, engine->curorient);
+   depth[state] = 0;
+   queue[tail++] = state;
+   while (head < tail)
+	 {
+		state = queue[head++];
+		copy = *engine;
+		position(&copy, state);
+		if (resting(&copy)) rests++;
+		for (action = ACTION_LEFT; action <= ACTION_DOWN; action++)
+		  {
+			 copy = *engine;
+			 position(&copy, state);
+			 engine_move(&copy, action);
+			 next = STATE(copy.curx, copy.cury, copy.curorient);
+			 if (action == ACTION_DROP)
+			   {
+				  /* the same as moving down until it can't */
+				  slow = *engine;
+				  position(&slow, state);
+				  do
+					{
+					   rows = slow.cury;
+					   engine_move(&slow, ACTION_DOWN);
+					}
+				  while (slow.cury != rows);
+				  if (slow.cury != copy.cury || !resting(&copy)) return FALSE;
+			   }
+			 if (depth[next] >= 0) continue;
+			 depth[next] = depth[state] + 1;
+			 queue[tail++] = next;
+		  }
+	 }
+   if (rests != placements->count) return FALSE;
+   for (i = 0; i < placements->count; i++)
+	 {
+		const placement_t *placement = &placements->placement[i];
+		state = STATE(placement->x, placement->y, placement->orient);
+		/* reachable once, at rest, the shortest way there & nearest first */
+		if (placed[state] || depth[state] != placement->moves) return FALSE;
+		placed[state] = TRUE;
+		if (i > 0 && placement->moves < placements->placement[i - 1].moves) return FALSE;
+		copy = *engine;
+		position(&copy, state);
+		if (!resting(&copy)) return FALSE;
+		/* the path takes the shape there */
+		copy = *engine;
+		if (engine_placement_path(placements, placement, path) != placement->moves) return FALSE;
+		for (action = 0; action < placement->moves; action++) engine_move(&copy, path[action]);
+		if (STATE(copy.curx, copy.cury, copy.curorient) != state) return FALSE;
+	 }
+   return TRUE;
+}
+
+/*
+ * Play random games, putting each shape in a random placement. Check the
+ * placements of every shape against the brute force search. Or restore a
+ * snapshot of the engine in a second one before every shape & make sure
+ * both play it exactly the same way.
+ */
+static bool games(bool snapshots)
+{
+   static placements_t placements;
+   action_t path[NUMSTATES];
+   engine_t engine,twin;
+   snapshot_t a,b;
+   uint64_t moves;
+   int game,piece,i,n,result;
+   for (game = 0; game < GAMES; game++)
+	 {
+		engine_init(&engine, scored, NULL, game + 1);
+		engine_init(&twin, scored, NULL, ~(uint64_t) game);
+		moves = game;
+		for (piece = 0; piece < PIECES; piece++)
+		  {
+			 if (snapshots)
+			   {
+				  engine_snapshot(&engine, &a);
+				  if (!engine_check(&a) || engine_restore(&twin, &a) != OK) return FALSE;
+				  engine_snapshot(&twin, &b);
+				  if (!same(&a, &b) || memcmp(engine_heights(&engine), engine_heights(&twin), NUMCOLS)) return FALSE;
+			   }
+			 if ((n = engine_enumerate_placements(&engine, &placements)) == 0) return FALSE;
+			 if (!snapshots && !placements_match(&engine, &placements)) return FALSE;
+			 n = engine_placement_path(&placements, &placements.placement[random_value(&moves, n)], path);
+			 for (i = 0; i < n; i++)
+			   {
+				  engine_move(&engine, path[i]);
+				  engine_move(&twin, path[i]);
+			   }
+			 do
+			   {
+				  result = engine_evaluate(&engine);
+				  if (snapshots && engine_evaluate(&twin) != result) return FALSE;
+			   }
+			 while (result > 0);
+			 if (snapshots)
+			   {
+				  engine_snapshot(&engine, &a);
+				  engine_snapshot(&twin, &b);
+				  if (!same(&a, &b)) return FALSE;
+			   }
+			 if (result < 0) break;
+		  }
+	 }
+   return TRUE;
+}
+
+static bool enumerate(int n) { return games(FALSE); }
+static bool roundtrip(int n) { return games(TRUE); }
+
+/*
+ * Snapshot checks
+ */
+
+/* Spoil a valid snapshot in one way (n) after another & make sure engine_check() notices, while the edges of the board are still fine */
+static bool check(int n)
+{
+   static const char *lines[] = { "...#......", "#.###...##", NULL };
+   engine_t engine;
+   snapshot_t valid,s;
+   const orient_t *orient;
+   int i;
+   if (setup(&engine, lines, 4, 1, 6, 5) != OK) return FALSE;
+   engine_snapshot(&engine, &valid);
+   if (!engine_check(&valid)) return FALSE;
+   orient = &SHAPES[valid.curshape].orient[valid.curorient];
+   /* every block as far out as it may go */
+   for (i = 0; i < 4; i++)
+	 {
+		s = valid;
+		if (i == 0) s.curx = 1 - orient->left;
+		if (i == 1) s.curx = NUMCOLS - 3 - orient->right;
+		if (i == 2) s.cury = -orient->top;
+		if (i == 3) s.cury = NUMROWS - 3 - orient->bottom;
+		if (!engine_check(&s)) return FALSE;
+	 }
+   /* and one step further */
+   for (i = 0; i < 17; i++)
+	 {
+		s = valid;
+		switch (i)
+		  {
+		   case 0: s.curx = -orient->left; break;
+		   case 1: s.curx = NUMCOLS - 2 - orient->right; break;
+		   case 2: s.cury = -1 - orient->top; break;
+		   case 3: s.cury = NUMROWS - 2 - orient->bottom; break;
+		   case 4: s.curorient = SHAPES[s.curshape].orients; break;
+		   case 5: s.curorient = -1; break;
+		   case 6: s.curshape = NUMSHAPES; break;
+		   case 7: s.curshape = -1; break;
+		   case 8: s.nextshape = NUMSHAPES; break;
+		   case 9: s.row[NUMROWS - 3] &= ~1; break;
+		   case 10: s.row[0] &= ~(1 << (NUMCOLS - 2)); break;
+		   case 11: s.row[7] &= ~(1 << (NUMCOLS - 1)); break;
+		   case 12: s.row[3] |= 1 << NUMCOLS; break;
+		   case 13: s.height[3]++; break;
+		   case 14: s.height[3]--; break;
+		   case 15: s.height[0] = 0; break;
+		   case 16: s.row[NUMROWS - 3] |= 1 << 2; break;
+		  }
+		if (engine_check(&s) || engine_restore(&engine, &s) != ERR) return FALSE;
+	 }
+   /* a snapshot that fails leaves the engine alone */
+   engine_snapshot(&engine, &s);
+   return same(&valid, &s);
+}
+
+static const struct
+{
+   const char *name;
+   bool (*run)(int n);
+   int n;
+} tests[] =
+{
+   { "no lines",                  lineclear, 0 },
+   { "one line",                  lineclear, 1 },
+   { "one line at the top",       lineclear, 2 },
+   { "two lines apart",           lineclear, 3 },
+   { "three lines",               lineclear, 4 },
+   { "four lines",                lineclear, 5 },
+   { "drops under overhangs",     overhang,  0 },
+   { "down never locks",          down,      0 },
+   { "placements & paths",        enumerate, 0 },
+   { "snapshot round trips",      roundtrip, 0 },
+   { "damaged snapshots",         check,     0 },
+   { NULL, NULL, 0 }
+};
+
+int main()
+{
+   int i,failed = 0;
+   for (i = 0; tests[i].name != NULL; i++)
+	 {
+		bool ok = tests[i].run(tests[i].n);
+		printf("%-28s %s\n", tests[i].name, ok ? "ok" : "FAILED");
+		if (!ok) failed++;
+	 }
+   exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,140 @@
+/*
+ * TINT - TINT Is Not Tetris
+ * Copyright (c) 2001-2025 Abraham van der Merwe <abz@frogfoot.com>
+ *
+ * This file is distributed under the terms of the MIT License.
+ * See the LICENSE file in the project root for full license text.
+ */
+
+/*
+ * Checks that replays with damaged keyframes are rejected (make check).
+ * Each test records a short game with one keyframe, spoils the keyframe
+ * in a different way and makes sure that neither reading through the
+ * replay nor seeking to the keyframe and carrying on from it accepts it.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "typedefs.h"
+#include "engine.h"
+#include "replay.h"
+#include "game.h"
+
+/* Ways to spoil a keyframe */
+static void nothing(keyframe_t *keyframe) { }
+static void outside(keyframe_t *keyframe) { keyframe->snapshot.curx = 90; keyframe->snapshot.cury = 100; }
+static void leftwall(keyframe_t *keyframe) { keyframe->snapshot.curx = 0; }
+static void floored(keyframe_t *keyframe) { keyframe->snapshot.cury = NUMROWS - 2; }
+static void orient(keyframe_t *keyframe) { keyframe->snapshot.curorient = SHAPES[keyframe->snapshot.curshape].orients; }
+static void shape(keyframe_t *keyframe) { keyframe->snapshot.nextshape = NUMSHAPES; }
+static void nowall(keyframe_t *keyframe) { keyframe->snapshot.row[NUMROWS - 3] &= ~1; }
+static void offboard(keyframe_t *keyframe) { keyframe->snapshot.row[5] |= 1 << NUMCOLS; }
+static void height(keyframe_t *keyframe) { keyframe->snapshot.height[0]++; }
+static void tall(keyframe_t *keyframe) { keyframe->snapshot.height[0] = NUMROWS - 1; }
+static void noshapes(keyframe_t *keyframe) { memset(keyframe->shapecount, 0, sizeof(keyframe->shapecount)); }
+static void negative(keyframe_t *keyframe) { keyframe->shapecount[0] = -1; }
+static void uncounted(keyframe_t *keyframe) { keyframe->shapecount[keyframe->snapshot.curshape] = 0; }
+static void toomany(keyframe_t *keyframe) { keyframe->shapecount[0] = keyframe->shapecount[1] = INT_MAX; }
+static void badlevel(keyframe_t *keyframe) { keyframe->level = MAXLEVEL + 1; }
+static void neglevel(keyframe_t *keyframe) { keyframe->level = -1; }
+
+static const struct
+{
+   const char *name;
+   void (*spoil)(keyframe_t *keyframe);
+   bool valid;
+} tests[] =
+{
+   { "valid keyframe",            nothing,   TRUE },
+   { "shape outside the board",   outside,   FALSE },
+   { "shape in the wall",         leftwall,  FALSE },
+   { "shape in the floor",        floored,   FALSE },
+   { "orientation out of range",  orient,    FALSE },
+   { "shape out of range",        shape,     FALSE },
+   { "row without its wall",      nowall,    FALSE },
+   { "row wider than the board",  offboard,  FALSE },
+   { "height doesn't match",      height,    FALSE },
+   { "height above the board",    tall,      FALSE },
+   { "no shapes counted",         noshapes,  FALSE },
+   { "negative shape count",      negative,  FALSE },
+   { "current shape not counted", uncounted, FALSE },
+   { "too many shapes",           toomany,   FALSE },
+   { "level out of range",        badlevel,  FALSE },
+   { "negative level",            neglevel,  FALSE },
+   { NULL, NULL, FALSE }
+};
+
+/* Record a game with one (spoiled) keyframe. Returns OK or ERR */
+static int record(const char *filename, void (*spoil)(keyframe_t *keyframe))
+{
+   replay_t replay;
+   game_t game;
+   keyframe_t keyframe;
+   game.level = MINLEVEL;
+   game.shownext = game.dottedlines = FALSE;
+   game.replay = NULL;
+   game_init(&game, 1);
+   if (replay_create(&replay, filename, 1, game.level, game_flags(&game)) != OK) return ERR;
+   /* drop a few shapes */
+   while (game_shapes(&game) < 4)
+	 {
+		if (game_gravity(&game) < 0) break;
+		game_event(&game, REPLAY_DROP);
+	 }
+   game_keyframe(&game, &keyframe);
+   spoil(&keyframe);
+   if (replay_keyframe(&replay, &keyframe) != OK) return ERR;
+   return replay_finish(&replay, game.ticks, GETSCORE(game.engine.score), game.engine.status.droppedlines);
+}
+
+/* Read the replay from the start & from its keyframe. Returns TRUE if both accept the keyframe & the game can carry on from it */
+static bool accepted(const char *filename)
+{
+   replay_t replay;
+   game_t game;
+   uint64_t tick;
+   int event;
+   bool read = FALSE,seek;
+   if (replay_open(&replay, filename) != OK) return FALSE;
+   while (replay_read(&replay, &tick, &event) == OK)
+	 if (event == REPLAY_END)
+	   {
+		  read = TRUE;
+		  break;
+	   }
+   seek = replay.keyframes == 1 && replay_seek(&replay, 0) == OK;
+   if (seek)
+	 {
+		game.level = replay.level;
+		game.shownext = game.dottedlines = FALSE;
+		game.replay = NULL;
+		game_init(&game, replay.seed);
+		seek = game_restore(&game, &replay.keyframe) == OK;
+	 }
+   replay_close(&replay);
+   return read && seek;
+}
+
+int main()
+{
+   char filename[] = "/tmp/tint-test-XXXXXX";
+   int i,fd,failed = 0;
+   if ((fd = mkstemp(filename)) < 0)
+	 {
+		perror("mkstemp");
+		exit(EXIT_FAILURE);
+	 }
+   close(fd);
+   for (i = 0; tests[i].name != NULL; i++)
+	 {
+		bool ok = record(filename, tests[i].spoil) == OK && accepted(filename) == tests[i].valid;
+		printf("%-28s %s\n", tests[i].name, ok ? "ok" : "FAILED");
+		if (!ok) failed++;
+	 }
+   unlink(filename);
+   exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -20,15 +20,15 @@
 #include "typedefs.h"
 #include "io.h"
 #include "engine.h"
+#include "game.h"
+#include "metrics.h"
+#include "replay.h"
 
 /* Default system score file (used as template) */
 #ifdef SCOREFILE
 const char default_scorefile[] = SCOREFILE;
 #endif
 
-/* User score file path */
-char scorefile[PATH_MAX];
-
 /*
  * Convert a string to integer. Returns TRUE if successful,
  * FALSE otherwise.
@@ -43,20 +43,21 @@ static bool strtoint(int *i, const char *str)
 }
 
 /* Initialize user-specific score file */
-static void init_scorefile(void)
+static void init_scorefile(game_t *game, char *path, size_t size)
 {
    const char *home = getenv("HOME");
    if (!home) home = ".";
    
-   snprintf(scorefile, sizeof(scorefile), "%s/.tint.scores", home);
+   snprintf(path, size, "%s/.tint.scores", home);
+   game->scorefile = path;
    
    /* If user score file doesn't exist, copy from system default if available */
    struct stat st;
-   if (stat(scorefile, &st) != 0) {
+   if (stat(game->scorefile, &st) != 0) {
 #ifdef SCOREFILE
       FILE *src = fopen(default_scorefile, "r");
       if (src) {
-         FILE *dst = fopen(scorefile, "w");
+         FILE *dst = fopen(game->scorefile, "w");
          if (dst) {
             char buffer[4096];
             size_t n;
@@ -75,59 +76,60 @@ static void init_scorefile(void)
  * Macros
  */
 
-/* Upper left corner of board */
-#define XTOP ((out_width () - NUMROWS - 3) >> 1)
-#define YTOP ((out_height () - NUMCOLS - 9) >> 1)
-
 /* Maximum digits in a number (i.e. number of digits in score, */
 /* number of blocks, etc. should not exceed this value */
 #define MAXDIGITS 11
 
-/* Number of levels in the game */
-#define MINLEVEL	1
-#define MAXLEVEL	9
-
-/* This calculates the time allowed to move a shape, before it is moved a row down */
-#define DELAY (1000000 / (level + 2))
+/* Default for the most times per second the screen is drawn */
+#define DEFAULTFPS	60
 
-/* The score is multiplied by this to avoid losing precision */
-#define SCOREFACTOR 2
+static int fps = DEFAULTFPS;
 
-/* This calculates the stored score value */
-#define SCOREVAL(x) (SCOREFACTOR * (x))
+/* Replays (see replay.h) */
+static const char *recordfile,*playfile;
+static bool backendchosen;
+static int seekto;
 
-/* This calculates the real (displayed) value of the score */
-#define GETSCORE(score) ((score) / SCOREFACTOR)
-
-static bool shownext;
-static bool dottedlines;
-static int level = MINLEVEL - 1,shapecount[NUMSHAPES];
+/* Where everything is on the screen (see setlayout()) */
+static struct
+{
+   int width,height;		/* size of the screen */
+   int boardx,boardy;		/* upper left corner of the board */
+   int statusx,statusy;	/* upper left corner of the status & help panel (on the left) */
+   int statsx,statsy;		/* upper left corner of the statistics panel (on the right) */
+} layout;
 
 /*
  * Functions
  */
 
-/* This function is responsible for increasing the score appropriately whenever
- * a block collides at the bottom of the screen (or the top of the heap */
-static void score_function(engine_t *engine)
-{
-   int score = SCOREVAL(level * (engine->status.dropcount + 1));
+/* Background cell with a dotted line (drawn differently from a plain background cell) */
+#define DOTTED (WALL + 1)
 
-   if (shownext) score /= 2;
-   if (dottedlines) score /= 2;
+/* What was last drawn in each cell of the board on the screen (-1 = unknown) */
+static int screen[NUMROWS][NUMCOLS];
 
-   engine->score += score;
+/* Forget what is on the screen, so that the whole board is drawn next time */
+static void invalidateboard()
+{
+   memset(screen, 0xff, sizeof(screen));
 }
 
-/* Draw the board on the screen */
-static void drawboard(board_t board)
+/* Draw the cells of the board that changed since it was last drawn */
+static void drawboard(const game_t *game)
 {
-   int x, y;
+   int x, y, cell;
+   board_t view;
+   engine_view(&game->engine, &view);
    out_setattr(ATTR_OFF);
    for (y = 1; y < NUMROWS - 1; y++) for (x = 0; x < NUMCOLS - 1; x++)
 	 {
-		out_gotoxy(XTOP + x * 2, YTOP + y);
-		switch (board[x][y])
+		cell = view.color[y][x];
+		if (cell == COLOR_BLACK && game->dottedlines) cell = DOTTED;
+		if (screen[y][x] == cell) continue;
+		screen[y][x] = cell;
+		out_gotoxy(layout.boardx + x * 2, layout.boardy + y);
+		switch (cell)
 		  {
 			 /* Wall */
 		   case WALL:
@@ -137,24 +139,21 @@ static void drawboard(board_t board)
 			 out_putch('>');
 			 out_setattr(ATTR_OFF);
 			 break;
+			 /* Background with dotted lines */
+		   case DOTTED:
+			 out_setcolor(COLOR_BLUE, COLOR_BLACK);
+			 out_putch('.');
+			 out_putch(' ');
+			 break;
 			 /* Background */
-		   case 0:
-			 if (dottedlines)
-			   {
-				  out_setcolor(COLOR_BLUE, COLOR_BLACK);
-				  out_putch('.');
-				  out_putch(' ');
-			   }
-			 else
-			   {
-				  out_setcolor(COLOR_BLACK, COLOR_BLACK);
-				  out_putch(' ');
-				  out_putch(' ');
-			   }
+		   case COLOR_BLACK:
+			 out_setcolor(COLOR_BLACK, COLOR_BLACK);
+			 out_putch(' ');
+			 out_putch(' ');
 			 break;
 			 /* Block */
 		   default:
-			 out_setcolor(COLOR_BLACK, board[x][y]);
+			 out_setcolor(COLOR_BLACK, cell);
 			 out_putch(' ');
 			 out_putch(' ');
 		  }
@@ -177,155 +176,275 @@ static void drawnext(int shapenum, int x, int y)
    out_setcolor(COLOR_BLACK, SHAPES[shapenum].color);
    for (i = 0; i < NUMBLOCKS; i++)
 	 {
-		out_gotoxy(x + SHAPES[shapenum].block[i].x * 2 + ofs[shapenum].x,
-					y + SHAPES[shapenum].block[i].y + ofs[shapenum].y);
+		out_gotoxy(x + SHAPES[shapenum].orient[0].block[i].x * 2 + ofs[shapenum].x,
+					y + SHAPES[shapenum].orient[0].block[i].y + ofs[shapenum].y);
 		out_putch(' ');
 		out_putch(' ');
 	 }
 }
 
-/* Draw the background */
-static void drawbackground()
+/* Work out where everything goes on the screen */
+static void setlayout()
 {
-   out_setattr(ATTR_OFF);
-   out_setcolor(COLOR_WHITE, COLOR_BLACK);
-   out_gotoxy(4, YTOP + 7);   out_printf("H E L P");
-   out_gotoxy(1, YTOP + 9);   out_printf("p: Pause");
-   out_gotoxy(1, YTOP + 10);  out_printf("j: Left");
-   out_gotoxy(1, YTOP + 11);  out_printf("l: Right");
-   out_gotoxy(1, YTOP + 12);  out_printf("k: Rotate");
-   out_gotoxy(1, YTOP + 13);  out_printf("s: Draw next");
-   out_gotoxy(1, YTOP + 14);  out_printf("d: Toggle lines");
-   out_gotoxy(1, YTOP + 15);  out_printf("a: Speed up");
-   out_gotoxy(1, YTOP + 16);  out_printf("q: Quit");
-   out_gotoxy(2, YTOP + 17);  out_printf("SPACE: Drop");
-   out_gotoxy(3, YTOP + 19);  out_printf("Next:");
+   layout.width = out_width();
+   layout.height = out_height();
+   layout.boardx = (layout.width - NUMROWS - 3) >> 1;
+   layout.boardy = (layout.height - NUMCOLS - 9) >> 1;
+   layout.statusx = 0;
+   layout.statusy = layout.boardy;
+   layout.statsx = layout.width - MAXDIGITS - 17;
+   layout.statsy = layout.boardy;
 }
 
-static int getsum()
-{
-   int i, sum = 0;
-   for (i = 0; i < NUMSHAPES; i++) sum += shapecount[i];
-   return (sum);
-}
+/* Order in which the shapes are listed in the statistics */
+static const int shapenum[NUMSHAPES] = { 4, 6, 5, 1, 0, 3, 2 };
 
-/* This show the current status of the game */
-static void showstatus(engine_t *engine)
+/* Draw the background (everything on the screen that never changes) */
+static void drawbackground()
 {
-   static const int shapenum[NUMSHAPES] = { 4, 6, 5, 1, 0, 3, 2 };
-   char tmp[MAXDIGITS + 1];
-   int i, sum = getsum();
-   out_setattr(ATTR_OFF);
-   out_setcolor(COLOR_WHITE, COLOR_BLACK);
-   out_gotoxy(1, YTOP + 1);   out_printf("Your level: %d", level);
-   out_gotoxy(1, YTOP + 2);   out_printf("Full lines: %d", engine->status.droppedlines);
-   out_gotoxy(2, YTOP + 4);   out_printf("Score");
-   out_setattr(ATTR_BOLD);
-   out_setcolor (COLOR_YELLOW,COLOR_BLACK);
-   out_printf ("  %d",GETSCORE (engine->score));
-   if (shownext) drawnext (engine->nextshape,3,YTOP + 22);
+   int i;
    out_setattr(ATTR_OFF);
    out_setcolor(COLOR_WHITE, COLOR_BLACK);
-   out_gotoxy (out_width () - MAXDIGITS - 12,YTOP + 1);
+   out_gotoxy(layout.statusx + 4, layout.statusy + 7);   out_printf("H E L P");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 9);   out_printf("p: Pause");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 10);  out_printf("j: Left");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 11);  out_printf("l: Right");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 12);  out_printf("k: Rotate");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 13);  out_printf("s: Draw next");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 14);  out_printf("d: Toggle lines");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 15);  out_printf("a: Speed up");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 16);  out_printf("q: Quit");
+   out_gotoxy(layout.statusx + 2, layout.statusy + 17);  out_printf("SPACE: Drop");
+   out_gotoxy(layout.statusx + 3, layout.statusy + 19);  out_printf("Next:");
+   /* Status */
+   out_gotoxy(layout.statusx + 1, layout.statusy + 1);   out_printf("Your level:");
+   out_gotoxy(layout.statusx + 1, layout.statusy + 2);   out_printf("Full lines:");
+   out_gotoxy(layout.statusx + 2, layout.statusy + 4);   out_printf("Score");
+   out_gotoxy(layout.statsx + 5, layout.statsy + 1);
    out_printf ("STATISTICS");
+   /* A picture of each shape, followed by a separator */
    out_setcolor (COLOR_BLACK,COLOR_MAGENTA);
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 3);
+   out_gotoxy(layout.statsx, layout.statsy + 3);
    out_printf ("      ");
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 4);
+   out_gotoxy(layout.statsx, layout.statsy + 4);
    out_printf ("  ");
-   out_setcolor (COLOR_MAGENTA,COLOR_BLACK);
-   out_gotoxy (out_width () - MAXDIGITS - 3,YTOP + 3);
-   out_putch ('-');
-   snprintf(tmp, MAXDIGITS + 1, "%d", shapecount[shapenum[0]]);
-   out_gotoxy(out_width() - strlen(tmp) - 1, YTOP + 3);
-   out_printf("%s", tmp);
    out_setcolor (COLOR_BLACK,COLOR_RED);
-   out_gotoxy (out_width () - MAXDIGITS - 13,YTOP + 5);
+   out_gotoxy(layout.statsx + 4, layout.statsy + 5);
    out_printf("        ");
-   out_setcolor (COLOR_RED,COLOR_BLACK);
-   out_gotoxy(out_width() - MAXDIGITS - 3, YTOP + 5);
-   out_putch ('-');
-   snprintf(tmp, MAXDIGITS + 1, "%d", shapecount[shapenum[1]]);
-   out_gotoxy(out_width() - strlen(tmp) - 1, YTOP + 5);
-   out_printf("%s", tmp);
    out_setcolor(COLOR_BLACK, COLOR_WHITE);
-   out_gotoxy(out_width() - MAXDIGITS - 17, YTOP + 7);
+   out_gotoxy(layout.statsx, layout.statsy + 7);
    out_printf ("      ");
-   out_gotoxy(out_width() - MAXDIGITS - 13, YTOP + 8);
+   out_gotoxy(layout.statsx + 4, layout.statsy + 8);
    out_printf ("  ");
-   out_setcolor(COLOR_WHITE, COLOR_BLACK);
-   out_gotoxy(out_width() - MAXDIGITS - 3, YTOP + 7);
-   out_putch ('-');
-   snprintf(tmp, MAXDIGITS + 1, "%d", shapecount[shapenum[2]]);
-   out_gotoxy(out_width() - strlen(tmp) - 1, YTOP + 7);
-   out_printf("%s", tmp);
    out_setcolor(COLOR_BLACK, COLOR_GREEN);
-   out_gotoxy(out_width() - MAXDIGITS - 9, YTOP + 9);
+   out_gotoxy(layout.statsx + 8, layout.statsy + 9);
    out_printf("    ");
-   out_gotoxy(out_width() - MAXDIGITS - 11, YTOP + 10);
+   out_gotoxy(layout.statsx + 6, layout.statsy + 10);
    out_printf("    ");
-   out_setcolor(COLOR_GREEN, COLOR_BLACK);
-   out_gotoxy(out_width() - MAXDIGITS - 3, YTOP + 9);
-   out_putch ('-');
-   snprintf(tmp, MAXDIGITS + 1, "%d", shapecount[shapenum[3]]);
-   out_gotoxy(out_width() - strlen(tmp) - 1, YTOP + 9);
-   out_printf("%s", tmp);
    out_setcolor (COLOR_BLACK,COLOR_CYAN);
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 11);
+   out_gotoxy(layout.statsx, layout.statsy + 11);
    out_printf("    ");
-   out_gotoxy (out_width () - MAXDIGITS - 15,YTOP + 12);
+   out_gotoxy(layout.statsx + 2, layout.statsy + 12);
    out_printf("    ");
-   out_setcolor (COLOR_CYAN,COLOR_BLACK);
-   out_gotoxy (out_width () - MAXDIGITS - 3,YTOP + 11);
-   out_putch ('-');
-   snprintf (tmp,MAXDIGITS + 1,"%d",shapecount[shapenum[4]]);
-   out_gotoxy (out_width () - strlen (tmp) - 1,YTOP + 11);
-   out_printf("%s", tmp);
    out_setcolor (COLOR_BLACK,COLOR_BLUE);
-   out_gotoxy (out_width () - MAXDIGITS - 9,YTOP + 13);
+   out_gotoxy(layout.statsx + 8, layout.statsy + 13);
    out_printf("    ");
-   out_gotoxy (out_width () - MAXDIGITS - 9,YTOP + 14);
+   out_gotoxy(layout.statsx + 8, layout.statsy + 14);
    out_printf("    ");
-   out_setcolor(COLOR_BLUE, COLOR_BLACK);
-   out_gotoxy (out_width () - MAXDIGITS - 3,YTOP + 13);
-   out_putch ('-');
-   snprintf (tmp,MAXDIGITS + 1,"%d",shapecount[shapenum[5]]);
-   out_gotoxy (out_width () - strlen (tmp) - 1,YTOP + 13);
-   out_printf("%s", tmp);
-   out_setattr(ATTR_OFF);
    out_setcolor (COLOR_BLACK,COLOR_YELLOW);
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 15);
+   out_gotoxy(layout.statsx, layout.statsy + 15);
    out_printf ("      ");
-   out_gotoxy (out_width () - MAXDIGITS - 15,YTOP + 16);
+   out_gotoxy(layout.statsx + 2, layout.statsy + 16);
    out_printf ("  ");
-   out_setcolor (COLOR_YELLOW,COLOR_BLACK);
-   out_gotoxy (out_width () - MAXDIGITS - 3,YTOP + 15);
-   out_putch ('-');
-   snprintf (tmp,MAXDIGITS + 1,"%d",shapecount[shapenum[6]]);
-   out_gotoxy (out_width () - strlen (tmp) - 1,YTOP + 15);
-   out_printf("%s", tmp);
+   for (i = 0; i < NUMSHAPES; i++)
+	 {
+		out_setcolor(SHAPES[shapenum[i]].color, COLOR_BLACK);
+		out_gotoxy(layout.statsx + 14, layout.statsy + 3 + i * 2);
+		out_putch('-');
+	 }
    out_setcolor(COLOR_WHITE, COLOR_BLACK);
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 17);
+   out_gotoxy(layout.statsx, layout.statsy + 17);
    for (i = 0; i < MAXDIGITS + 16; i++) out_putch ('-');
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 18);
+   out_gotoxy(layout.statsx, layout.statsy + 18);
    out_printf ("Sum          :");
-   snprintf (tmp,MAXDIGITS + 1,"%d",sum);
-   out_gotoxy (out_width () - strlen (tmp) - 1,YTOP + 18);
-   out_printf("%s", tmp);
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 20);
-   for (i = 0; i < MAXDIGITS + 16; i++) out_putch(' ');
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 20);
+   out_gotoxy(layout.statsx, layout.statsy + 20);
    out_printf ("Score ratio  :");
-   snprintf (tmp,MAXDIGITS + 1,"%d",GETSCORE (engine->score) / sum);
-   out_gotoxy (out_width () - strlen (tmp) - 1,YTOP + 20);
-   out_printf("%s", tmp);
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 21);
-   for (i = 0; i < MAXDIGITS + 16; i++) out_putch(' ');
-   out_gotoxy (out_width () - MAXDIGITS - 17,YTOP + 21);
+   out_gotoxy(layout.statsx, layout.statsy + 21);
    out_printf ("Efficiency   :");
-   snprintf (tmp,MAXDIGITS + 1,"%d",engine->status.efficiency);
-   out_gotoxy (out_width () - strlen (tmp) - 1,YTOP + 21);
-   out_printf("%s", tmp);
+}
+
+/* Values in the status panel when it was last drawn */
+static struct
+{
+   bool valid;
+   int level,lines,score,nextshape;
+   int shapecount[NUMSHAPES],sum,ratio,efficiency;
+} shown;
+
+/* Forget what the status panel shows, so that all of it is drawn next time */
+static void invalidatestatus()
+{
+   shown.valid = FALSE;
+}
+
+/* Draw a number right-aligned against the edge of the screen, over the previous one */
+static void drawnumber(int y, int value)
+{
+   char tmp[MAXDIGITS + 1];
+   snprintf(tmp, MAXDIGITS + 1, "%d", value);
+   out_gotoxy(layout.statsx + 16, y);
+   out_printf("%*s", MAXDIGITS, tmp);
+}
+
+/* This show the current status of the game (only the values that changed) */
+static void showstatus(const game_t *game)
+{
+   const engine_t *engine = &game->engine;
+   int i, sum = game_shapes(game);
+   out_setattr(ATTR_OFF);
+   out_setcolor(COLOR_WHITE, COLOR_BLACK);
+   if (!shown.valid || shown.level != game->level)
+	 {
+		out_gotoxy(layout.statusx + 13, layout.statusy + 1);	out_printf("%d", game->level);
+		shown.level = game->level;
+	 }
+   if (!shown.valid || shown.lines != engine->status.droppedlines)
+	 {
+		out_gotoxy(layout.statusx + 13, layout.statusy + 2);	out_printf("%d", engine->status.droppedlines);
+		shown.lines = engine->status.droppedlines;
+	 }
+   if (!shown.valid || shown.score != engine->score)
+	 {
+		out_setattr(ATTR_BOLD);
+		out_setcolor (COLOR_YELLOW,COLOR_BLACK);
+		out_gotoxy(layout.statusx + 7, layout.statusy + 4);	out_printf ("  %d",GETSCORE (engine->score));
+		out_setattr(ATTR_OFF);
+		shown.score = engine->score;
+	 }
+   if (game->shownext && (!shown.valid || shown.nextshape != engine->nextshape))
+	 {
+		drawnext(engine->nextshape, layout.statusx + 3, layout.statusy + 22);
+		shown.nextshape = engine->nextshape;
+	 }
+   else if (!game->shownext) shown.nextshape = -1;
+   for (i = 0; i < NUMSHAPES; i++)
+	 if (!shown.valid || shown.shapecount[i] != game->shapecount[shapenum[i]])
+	   {
+		  out_setcolor(SHAPES[shapenum[i]].color, COLOR_BLACK);
+		  drawnumber(layout.statsy + 3 + i * 2, game->shapecount[shapenum[i]]);
+		  shown.shapecount[i] = game->shapecount[shapenum[i]];
+	   }
+   out_setcolor(COLOR_WHITE, COLOR_BLACK);
+   if (!shown.valid || shown.sum != sum)
+	 {
+		drawnumber(layout.statsy + 18, sum);
+		shown.sum = sum;
+	 }
+   if (!shown.valid || shown.ratio != GETSCORE (engine->score) / sum)
+	 {
+		drawnumber(layout.statsy + 20, GETSCORE (engine->score) / sum);
+		shown.ratio = GETSCORE (engine->score) / sum;
+	 }
+   if (!shown.valid || shown.efficiency != engine->status.efficiency)
+	 {
+		drawnumber(layout.statsy + 21, engine->status.efficiency);
+		shown.efficiency = engine->status.efficiency;
+	 }
+   shown.valid = TRUE;
+}
+
+/* When the oldest key that isn't on the screen yet arrived (0 = none), for METRIC_LATENCY */
+static int64_t keytime;
+
+/* Draw everything that changed and show it on the screen (measuring how long it took if we're asked to) */
+static void drawscreen(const game_t *game)
+{
+   int64_t start,status,board,end;
+   unsigned long calls,bytes,calls2,bytes2;
+   if (!metrics_enabled)
+	 {
+		showstatus(game);
+		drawboard(game);
+		out_refresh();
+		return;
+	 }
+   out_stats(&calls, &bytes);
+   start = metrics_now();
+   showstatus(game);
+   status = metrics_now();
+   drawboard(game);
+   board = metrics_now();
+   out_refresh();
+   end = metrics_now();
+   out_stats(&calls2, &bytes2);
+   metrics_add(METRIC_SHOWSTATUS, status - start);
+   metrics_add(METRIC_DRAWBOARD, board - status);
+   metrics_add(METRIC_REFRESH, end - board);
+   metrics_add(METRIC_CALLS, calls2 - calls);
+   metrics_add(METRIC_BYTES, bytes2 - bytes);
+   if (keytime)
+	 {
+		metrics_add(METRIC_LATENCY, end - keytime);
+		keytime = 0;
+	 }
+}
+
+/* Do what the player asked for (and record it if we're recording a replay) */
+static void doevent(game_t *game, int event)
+{
+   if (!game_event(game, event)) out_beep();
+   else if (event == REPLAY_LEVELUP) in_timeout(DELAY(game->level));
+}
+
+/* Move the shape down a row. Returns FALSE if the game is over */
+static bool gravity(game_t *game)
+{
+   int level = game->level;
+   if (game_gravity(game) < 0) return FALSE;
+   /* the shapes fall faster at the next level */
+   if (game->level != level) in_timeout(DELAY(game->level));
+   return TRUE;
+}
+
+/* Show (or hide) the pause message at the bottom of the screen */
+static void showpaused(bool paused)
+{
+   out_setcolor(COLOR_WHITE, COLOR_BLACK);
+   out_gotoxy((layout.width - 34) / 2, layout.height - 2);
+   out_printf("%-34s", paused ? "Paused - Press any key to continue" : "");
+}
+
+/* Lay out the screen again and draw all of it next time (at startup and when the screen changes size) */
+static void redrawscreen()
+{
+   setlayout();
+   drawbackground();
+   invalidateboard();
+   invalidatestatus();
+}
+
+/* Stop gravity until a key is pressed */
+static void pausegame(const game_t *game)
+{
+   int events;
+   showpaused(TRUE);
+   out_refresh();
+   in_timeout(0);
+   while (!((events = in_wait(-1)) & IN_KEY))
+	 {
+		if (metrics_enabled) metrics_poll();
+		if (events & IN_RESIZE)
+		  {
+			 redrawscreen();
+			 drawscreen(game);
+			 showpaused(TRUE);
+			 out_refresh();
+		  }
+	 }
+   in_flush();				/* Clear keyboard buffer */
+   in_timeout(DELAY(game->level));
+   showpaused(FALSE);
+   redrawscreen();			/* The message might have covered part of the screen */
 }
 
           /***************************************************************************/
@@ -359,7 +478,7 @@ static void getname(char *name)
    fprintf(stderr, "Enter your name [%s]: ", pw != NULL ? pw->pw_name : "");
 
    if (!fgets(name, NAMELEN - 1, stdin)) name[0] = '\0';
-   name[strlen(name) - 1] = '\0';
+   name[strcspn(name, "\n")] = '\0';
 
    if (!strlen(name) && pw != NULL)
 	 {
@@ -368,29 +487,30 @@ static void getname(char *name)
 	 }
 }
 
-static void err1()
+static void err1(const char *scorefile)
 {
    fprintf(stderr, "Error creating %s\n", scorefile);
    exit(EXIT_FAILURE);
 }
 
-static void err2()
+static void err2(const char *scorefile)
 {
    fprintf(stderr, "Error writing to %s\n", scorefile);
    exit(EXIT_FAILURE);
 }
 
-void showplayerstats(engine_t *engine)
+void showplayerstats(const game_t *game)
 {
+   const engine_t *engine = &game->engine;
    fprintf(stderr,
 			"\n\t   PLAYER STATISTICS\n\n\t"
 			"Score       %11d\n\t"
 			"Efficiency  %11d\n\t"
 			"Score ratio %11d\n",
-			GETSCORE(engine->score), engine->status.efficiency, GETSCORE(engine->score) / getsum());
+			GETSCORE(engine->score), engine->status.efficiency, GETSCORE(engine->score) / game_shapes(game));
 }
 
-static void createscores(int score)
+static void createscores(const char *scorefile, int score)
 {
    FILE *handle;
    int i,j;
@@ -406,18 +526,18 @@ static void createscores(int score)
    getname(scores[0].name);
    scores[0].score = score;
    scores[0].timestamp = time(NULL);
-   if ((handle = fopen(scorefile, "w")) == NULL) err1();
+   if ((handle = fopen(scorefile, "w")) == NULL) err1(scorefile);
    strcpy(header, SCORE_HEADER);
    i = fwrite(header, strlen(SCORE_HEADER), 1, handle);
-   if (i != 1) err2();
+   if (i != 1) err2(scorefile);
    for (i = 0; i < NUMSCORES; i++)
 	 {
 		j = fwrite(scores[i].name, strlen(scores[i].name) + 1, 1, handle);
-		if (j != 1) err2();
+		if (j != 1) err2(scorefile);
 		j = fwrite(&(scores[i].score), sizeof(int), 1, handle);
-		if (j != 1) err2();
+		if (j != 1) err2(scorefile);
 		j = fwrite(&(scores[i].timestamp), sizeof(time_t), 1, handle);
-		if (j != 1) err2();
+		if (j != 1) err2(scorefile);
 	 }
    fclose(handle);
 
@@ -443,8 +563,10 @@ static int cmpscores(const void *a, const void *b)
    return 0;
 }
 
-static void savescores(int score)
+static void savescores(const game_t *game)
 {
+   const char *scorefile = game->scorefile;
+   int score = GETSCORE(game->engine.score);
    FILE *handle;
    int i, j, ch;
    score_t scores[NUMSCORES];
@@ -452,13 +574,13 @@ static void savescores(int score)
    time_t tmp = 0;
    if ((handle = fopen(scorefile, "r")) == NULL)
 	 {
-		createscores (score);
+		createscores (scorefile, score);
 		return;
 	 }
    i = fread(header, strlen(SCORE_HEADER), 1, handle);
    if ((i != 1) || (strncmp(SCORE_HEADER, header, strlen(SCORE_HEADER)) != 0))
 	 {
-		createscores (score);
+		createscores (scorefile, score);
 		return;
 	 }
    for (i = 0; i < NUMSCORES; i++)
@@ -468,7 +590,7 @@ static void savescores(int score)
 		  {
 			 if ((ch == EOF) || (j >= NAMELEN - 2))
 			   {
-				  createscores (score);
+				  createscores (scorefile, score);
 				  return;
 			   }
 			 scores[i].name[j++] = (char) ch;
@@ -477,13 +599,13 @@ static void savescores(int score)
 		j = fread(&(scores[i].score), sizeof(int), 1, handle);
 		if (j != 1)
 		  {
-			 createscores (score);
+			 createscores (scorefile, score);
 			 return;
 		  }
 		j = fread(&(scores[i].timestamp), sizeof(time_t), 1, handle);
 		if (j != 1)
 		  {
-			 createscores (score);
+			 createscores (scorefile, score);
 			 return;
 		  }
 	 }
@@ -495,18 +617,18 @@ static void savescores(int score)
 		scores[NUMSCORES - 1].timestamp = tmp = time(NULL);
 	 }
    qsort(scores, NUMSCORES, sizeof(score_t), cmpscores);
-   if ((handle = fopen(scorefile, "w")) == NULL) err2();
+   if ((handle = fopen(scorefile, "w")) == NULL) err2(scorefile);
    strcpy(header, SCORE_HEADER);
    i = fwrite(header, strlen(SCORE_HEADER), 1, handle);
-   if (i != 1) err2();
+   if (i != 1) err2(scorefile);
    for (i = 0; i < NUMSCORES; i++)
 	 {
 		j = fwrite(scores[i].name, strlen(scores[i].name) + 1, 1, handle);
-		if (j != 1) err2();
+		if (j != 1) err2(scorefile);
 		j = fwrite(&(scores[i].score), sizeof(int), 1, handle);
-		if (j != 1) err2();
+		if (j != 1) err2(scorefile);
 		j = fwrite(&(scores[i].timestamp), sizeof(time_t), 1, handle);
-		if (j != 1) err2();
+		if (j != 1) err2(scorefile);
 	 }
    fclose(handle);
 
@@ -527,15 +649,25 @@ static void savescores(int score)
 
 static void showhelp()
 {
-   fprintf(stderr, "USAGE: tint [-h] [-l level] [-n]\n");
+   const char *name,*description;
+   int i;
+   fprintf(stderr, "USAGE: tint [-h] [-l level] [-n] [-d] [-f fps] [-b backend] [-m file] [-r file | -p file [-t tick]]\n");
    fprintf(stderr, "  -h           Show this help message\n");
    fprintf(stderr, "  -l <level>   Specify the starting level (%d-%d)\n", MINLEVEL, MAXLEVEL);
    fprintf(stderr, "  -n           Draw next shape\n");
    fprintf(stderr, "  -d           Draw vertical dotted lines\n");
+   fprintf(stderr, "  -f <fps>     Draw the screen at most fps times per second (0 = no limit, default %d)\n", DEFAULTFPS);
+   fprintf(stderr, "  -b <backend> Terminal I/O backend to use:\n");
+   for (i = 0; io_backend(i, &name, &description); i++) fprintf(stderr, "                 %-8s %s\n", name, description);
+   fprintf(stderr, "  -m <file>    Measure the cost of drawing the screen, write a report to file\n");
+   fprintf(stderr, "               at exit and on SIGUSR1\n");
+   fprintf(stderr, "  -r <file>    Record the game to a replay file\n");
+   fprintf(stderr, "  -p <file>    Play a replay file as fast as possible (and draw it if -b is given)\n");
+   fprintf(stderr, "  -t <tick>    Start playing the replay at this gravity tick\n");
    exit(EXIT_FAILURE);
 }
 
-static void parse_options(int argc, char *argv[])
+static void parse_options(int argc, char *argv[], game_t *game)
 {
    int i = 1;
    while (i < argc)
@@ -547,8 +679,8 @@ static void parse_options(int argc, char *argv[])
 		else if (strcmp(argv[i], "-l") == 0)
 		  {
 			 i++;
-			 if (i >= argc || !strtoint(&level, argv[i])) showhelp();
-			 if ((level < MINLEVEL) || (level > MAXLEVEL))
+			 if (i >= argc || !strtoint(&game->level, argv[i])) showhelp();
+			 if ((game->level < MINLEVEL) || (game->level > MAXLEVEL))
 			   {
 				  fprintf(stderr, "You must specify a level between %d and %d\n", MINLEVEL, MAXLEVEL);
 				  exit(EXIT_FAILURE);
@@ -556,9 +688,59 @@ static void parse_options(int argc, char *argv[])
 		  }
 		/* Show next? */
 		else if (strcmp(argv[i], "-n") == 0)
-		  shownext = TRUE;
+		  game->shownext = TRUE;
 		else if(strcmp(argv[i], "-d")==0)
-		  dottedlines = TRUE;
+		  game->dottedlines = TRUE;
+		/* Frame rate? */
+		else if (strcmp(argv[i], "-f") == 0)
+		  {
+			 i++;
+			 if (i >= argc || !strtoint(&fps, argv[i]) || fps < 0) showhelp();
+		  }
+		/* I/O backend? */
+		else if (strcmp(argv[i], "-b") == 0)
+		  {
+			 i++;
+			 if (i >= argc) showhelp();
+			 if (io_select(argv[i]) != OK)
+			   {
+				  fprintf(stderr, "Unknown backend -- %s\n", argv[i]);
+				  showhelp();
+			   }
+			 backendchosen = TRUE;
+		  }
+		/* Record a replay? */
+		else if (strcmp(argv[i], "-r") == 0)
+		  {
+			 i++;
+			 if (i >= argc) showhelp();
+			 recordfile = argv[i];
+		  }
+		/* Play a replay? */
+		else if (strcmp(argv[i], "-p") == 0)
+		  {
+			 i++;
+			 if (i >= argc) showhelp();
+			 playfile = argv[i];
+		  }
+		/* Where to start playing it? */
+		else if (strcmp(argv[i], "-t") == 0)
+		  {
+			 i++;
+			 if (i >= argc || !strtoint(&seekto, argv[i]) || seekto < 0) showhelp();
+		  }
+		/* Metrics? */
+		else if (strcmp(argv[i], "-m") == 0)
+		  {
+			 i++;
+			 if (i >= argc) showhelp();
+			 if (metrics_open(argv[i]) != OK)
+			   {
+				  fprintf(stderr, "Can't open %s\n", argv[i]);
+				  exit(EXIT_FAILURE);
+			   }
+			 out_measure();
+		  }
 		else
 		  {
 			 fprintf(stderr, "Invalid option -- %s\n", argv[i]);
@@ -568,7 +750,7 @@ static void parse_options(int argc, char *argv[])
 	 }
 }
 
-static void choose_level()
+static void choose_level(game_t *game)
 {
    char buf[NAMELEN];
 
@@ -576,9 +758,102 @@ static void choose_level()
 	 {
 		fprintf(stderr, "Choose a level to start [%d-%d]: ", MINLEVEL, MAXLEVEL);
 		if (!fgets(buf, NAMELEN - 1, stdin)) buf[0] = '\0';
-		buf[strlen(buf) - 1] = '\0';
+		buf[strcspn(buf, "\n")] = '\0';
 	 }
-   while (!strtoint(&level, buf) || level < MINLEVEL || level > MAXLEVEL);
+   while (!strtoint(&game->level, buf) || game->level < MINLEVEL || game->level > MAXLEVEL);
+}
+
+/* Show where the engine spent its time (only if it was built with -DENGINE_PROFILE) */
+static void showprofile()
+{
+   const char *name;
+   uint64_t calls,cycles;
+   int i;
+   for (i = 0; (name = engine_profile(i, &calls, &cycles)) != NULL; i++)
+	 {
+		if (!i) fprintf(stderr, "%-14s %14s %16s %12s\n", "function", "calls", "cycles", "cycles/call");
+		fprintf(stderr, "%-14s %14llu %16llu %12.1f\n", name, (unsigned long long) calls, (unsigned long long) cycles, calls ? (double) cycles / calls : 0.0);
+	 }
+}
+
+/* Play a recorded game as fast as we can (drawing it fps times a second if a backend was chosen) and exit */
+static void playback(game_t *game, const char *filename)
+{
+   replay_t replay;
+   keyframe_t keyframe;
+   uint64_t tick;
+   int n,event = ERR;
+   bool over = FALSE,diverged = FALSE;
+   int64_t now,nextframe = 0;
+   if (replay_open(&replay, filename) != OK || replay.level < MINLEVEL || replay.level > MAXLEVEL)
+	 {
+		fprintf(stderr, "%s is not a tint replay\n", filename);
+		exit(EXIT_FAILURE);
+	 }
+   game->level = replay.level;
+   game->shownext = (replay.flags & REPLAY_FLAG_SHOWNEXT) != 0;
+   game->dottedlines = (replay.flags & REPLAY_FLAG_DOTTED) != 0;
+   game_init(game, replay.seed);
+   /* start from the last keyframe before where we want to be */
+   if (seekto && (n = replay_find(&replay, seekto)) >= 0)
+	 {
+		if (replay_seek(&replay, n) != OK || game_restore(game, &replay.keyframe) != OK)
+		  {
+			 fprintf(stderr, "%s: keyframe %d is damaged\n", filename, n);
+			 exit(EXIT_FAILURE);
+		  }
+	 }
+   if (!backendchosen) io_select("null");
+   io_init();
+   redrawscreen();
+   while (!over && replay_read(&replay, &tick, &event) == OK)
+	 {
+		while (!over && game->ticks < tick) over = !gravity(game);
+		if (event == REPLAY_END) break;
+		/* stop at the first keyframe we don't agree with */
+		if (event == REPLAY_KEYFRAME)
+		  {
+			 game_keyframe(game, &keyframe);
+			 if (over || replay_compare(&keyframe, &replay.keyframe) != 0)
+			   {
+				  diverged = TRUE;
+				  break;
+			   }
+			 continue;
+		  }
+		if (!over) doevent(game, event);
+		if ((now = io_clock()) >= nextframe)
+		  {
+			 drawscreen(game);
+			 nextframe = fps ? now + 1000000 / fps : now;
+		  }
+	 }
+   /* the game might have ended sooner than it did in the recording */
+   while (!diverged && event != REPLAY_END && replay_read(&replay, &tick, &event) == OK) ;
+   drawscreen(game);
+   io_close();
+   metrics_close();
+   showprofile();
+   replay_close(&replay);
+   printf("%s: %llu ticks, score %d, %d lines\n", filename, (unsigned long long) game->ticks, GETSCORE(game->engine.score), game->engine.status.droppedlines);
+   fflush(stdout);
+   if (diverged)
+	 {
+		fprintf(stderr, "%s: does not match the recording after %llu ticks\n", filename, (unsigned long long) tick);
+		exit(EXIT_FAILURE);
+	 }
+   if (event != REPLAY_END)
+	 {
+		fprintf(stderr, "%s: the recording is incomplete\n", filename);
+		exit(EXIT_FAILURE);
+	 }
+   if (game->ticks != tick || replay.score != GETSCORE(game->engine.score) || replay.lines != game->engine.status.droppedlines)
+	 {
+		fprintf(stderr, "%s: does not match the recording (%llu ticks, score %d, %d lines)\n",
+				filename, (unsigned long long) tick, replay.score, replay.lines);
+		exit(EXIT_FAILURE);
+	 }
+   exit(EXIT_SUCCESS);
 }
 
           /***************************************************************************/
@@ -588,59 +863,83 @@ static void choose_level()
 int main(int argc, char *argv[])
 {
    bool finished;
-   int ch;
-   engine_t engine;
+   int ch,events;
+   bool dirty;
+   int64_t now,nextframe;
+   uint64_t seed = time(NULL);
+   game_t game;
+   replay_t replay;
+   char scorefile[PATH_MAX];
    /* Initialize */
-   init_scorefile();						/* initialize user score file */
-   engine_init(&engine, score_function);	/* must be called before using engine.curshape */
-   finished = shownext = FALSE;
-   memset(shapecount, 0, NUMSHAPES * sizeof(int));
-   shapecount[engine.curshape]++;
-   parse_options(argc, argv);				/* must be called after initializing variables */
-   if (level < MINLEVEL) choose_level();
+   init_scorefile(&game, scorefile, sizeof(scorefile));	/* initialize user score file */
+   finished = game.shownext = game.dottedlines = FALSE;
+   game.level = MINLEVEL - 1;
+   game.replay = NULL;
+   parse_options(argc, argv, &game);		/* must be called after initializing variables */
+   if (seekto && playfile == NULL) showhelp();
+   if (playfile != NULL) playback(&game, playfile);
+   if (game.level < MINLEVEL) choose_level(&game);
+   game_init(&game, seed);
+   if (recordfile != NULL)
+	 {
+		if (replay_create(&replay, recordfile, seed, game.level, game_flags(&game)) != OK)
+		  {
+			 fprintf(stderr, "Can't create %s\n", recordfile);
+			 exit(EXIT_FAILURE);
+		  }
+		game.replay = &replay;
+	 }
    io_init();
-   drawbackground();
-   in_timeout(DELAY);
+   redrawscreen();
+   in_timeout(DELAY(game.level));
+   ch = ERR;
+   dirty = TRUE;
+   nextframe = 0;
    /* Main loop */
    do
 	 {
-		/* draw shape */
-		showstatus(&engine);
-		drawboard(engine.board);
-		out_refresh();
-		/* Check if user pressed a key */
-		if ((ch = in_getch()) != ERR)
+		/* Draw the screen if anything changed, but not more than fps times a second */
+		now = io_clock();
+		if (dirty && now >= nextframe)
+		  {
+			 drawscreen(&game);
+			 dirty = FALSE;
+			 nextframe = fps ? now + 1000000 / fps : now;
+		  }
+		/* Wait for keys, gravity or a new screen size (or the next frame if we have something to draw) */
+		events = in_wait(dirty ? nextframe - now : -1);
+		if (events) dirty = TRUE;
+		if (metrics_enabled)
+		  {
+			 if ((events & IN_KEY) && !keytime) keytime = metrics_now();
+			 metrics_poll();
+		  }
+		if (events & IN_RESIZE) redrawscreen();
+		/* Handle every key the user pressed, in order */
+		while (!finished && (events & IN_KEY) && (ch = in_getch()) != ERR)
 		  {
 			 switch (ch)
 			   {
 				case 'j':
-				  engine_move(&engine, ACTION_LEFT);
+				  doevent(&game, REPLAY_LEFT);
 				  break;
 				case 'k':
-				  engine_move(&engine, ACTION_ROTATE);
+				  doevent(&game, REPLAY_ROTATE);
 				  break;
 				case 'l':
-				  engine_move(&engine, ACTION_RIGHT);
+				  doevent(&game, REPLAY_RIGHT);
 				  break;
 				case ' ':
-				  engine_move(&engine, ACTION_DROP);
+				  doevent(&game, REPLAY_DROP);
 				  break;
-				  /* show next piece */
 				case 's':
-				  shownext = TRUE;
+				  doevent(&game, REPLAY_SHOWNEXT);
 				  break;
-				  /* toggle dotted lines */
 				case 'd':
-				  dottedlines = !dottedlines;
+				  doevent(&game, REPLAY_DOTTED);
 				  break;
-				  /* next level */
 				case 'a':
-				  if (level < MAXLEVEL)
-					{
-					   level++;
-					   in_timeout(DELAY);
-					}
-				  else out_beep();
+				  doevent(&game, REPLAY_LEVELUP);
 				  break;
 				  /* quit */
 				case 'q':
@@ -648,52 +947,29 @@ int main(int argc, char *argv[])
 				  break;
 				  /* pause */
 				case 'p':
-				  out_setcolor(COLOR_WHITE, COLOR_BLACK);
-				  out_gotoxy((out_width() - 34) / 2, out_height() - 2);
-				  out_printf("Paused - Press any key to continue");
-				  while ((ch = in_getch()) == ERR) ;	/* Wait for a key to be pressed */
-				  in_flush();							/* Clear keyboard buffer */
-				  out_gotoxy((out_width() - 34) / 2, out_height() - 2);
-				  out_printf("                                  ");
+				  pausegame(&game);
 				  break;
 				  /* unknown keypress */
 				default:
 				  out_beep();
 			   }
-			 in_flush();
-		  }
-		else
-		  {
-			 switch (engine_evaluate(&engine))
-			   {
-				  /* game over (board full) */
-				case -1:
-				  if ((level < MAXLEVEL) && ((engine.status.droppedlines / 10) > level)) level++;
-				  finished = TRUE;
-				  break;
-				  /* shape at bottom, next one released */
-				case 0:
-				  if ((level < MAXLEVEL) && ((engine.status.droppedlines / 10) > level))
-					{
-					   level++;
-					   in_timeout(DELAY);
-					}
-				  shapecount[engine.curshape]++;
-				  break;
-				  /* shape moved down one line */
-				case 1:
-				  break;
-			   }
 		  }
+		/* Move the shape down */
+		if (!finished && (events & IN_TICK) && !gravity(&game)) finished = TRUE;
 	 }
    while (!finished);
+   if (game.replay != NULL && replay_finish(game.replay, game.ticks, GETSCORE(game.engine.score), game.engine.status.droppedlines) != OK)
+	 game.recordfailed = TRUE;
    /* Restore console settings and exit */
    io_close();
+   metrics_close();
+   showprofile();
+   if (game.recordfailed) fprintf(stderr, "Error writing to %s, the recording is incomplete\n", recordfile);
    /* Don't bother the player if he want's to quit */
    if (ch != 'q')
 	 {
-		showplayerstats(&engine);
-		savescores(GETSCORE(engine.score));
+		showplayerstats(&game);
+		savescores(&game);
 	 }
    exit(EXIT_SUCCESS);
 }